@@ -0,0 +1,90 @@
+// Report: vertex cache efficiency of the mesh generators, before and after index optimization.
+// ACMR and ATVR are measured with a simulated 16 entry FIFO cache. Meshes are only generated, so
+// no GL context is needed.
+// Also checks that the welded teapots have no non-finite normal, and fails if they do.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+
+#include <glm/glm.hpp>
+
+#include "Geometry.hpp"
+#include "Mesh.hpp"
+#include "MeshOptimizer.hpp"
+#include "Teapot.hpp"
+
+using namespace std;
+using glm::vec3;
+
+static void report(const char* name, const function<Mesh()>& create)
+{
+    Mesh mesh = create();
+    if (mesh.indices.empty()) {
+        printf("%-28s %8zu vertices, not indexed\n", name, mesh.vertices.size());
+        return;
+    }
+
+    const VertexCacheStats before = analyzeVertexCache(mesh.indices, mesh.vertices.size());
+
+    const auto start = chrono::steady_clock::now();
+    optimizeVertexCache(mesh.indices, mesh.vertices.size());
+    const auto stop = chrono::steady_clock::now();
+    const VertexCacheStats after_cache = analyzeVertexCache(mesh.indices, mesh.vertices.size());
+
+    optimizeOverdraw(mesh.indices, mesh.vertices);
+    optimizeVertexFetch(mesh.vertices, mesh.indices);
+    const VertexCacheStats after_all = analyzeVertexCache(mesh.indices, mesh.vertices.size());
+
+    printf("%-28s %8zu tris  ACMR %5.3f -> %5.3f -> %5.3f  ATVR %5.3f -> %5.3f -> %5.3f  %8.2f ms\n",
+           name, mesh.indices.size() / 3,
+           before.acmr, after_cache.acmr, after_all.acmr,
+           before.atvr, after_cache.atvr, after_all.atvr,
+           chrono::duration<double, milli>(stop - start).count());
+}
+
+// Print and return the number of vertices whose normal is not finite.
+static size_t checkNormals(const char* name, const Mesh& mesh)
+{
+    size_t n_non_finite = 0;
+    for (const auto& vertex : mesh.vertices) {
+        if (!isfinite(vertex.normal.x) || !isfinite(vertex.normal.y) || !isfinite(vertex.normal.z))
+            ++n_non_finite;
+    }
+    printf("%-28s %8zu vertices, %zu non-finite normals\n", name, mesh.vertices.size(), n_non_finite);
+    return n_non_finite;
+}
+
+int main()
+{
+    // A gently curved 4x4 Bezier patch.
+    vector<vec3> control_points;
+    for (int i = 0; i < 4; ++i) {
+        for (int j = 0; j < 4; ++j)
+            control_points.emplace_back(i, (i == 1 || i == 2) && (j == 1 || j == 2) ? 1.0f : 0.0f, j);
+    }
+
+    printf("Vertex cache (16 entry FIFO): original -> cache optimized -> overdraw and fetch ordered\n");
+    report("Cube without indices", []() { return createCubeWithoutIndices(); });
+    report("Cube", []() { return createCube(); });
+    report("Quad", []() { return createQuad(); });
+    report("Square", []() { return createSquare(); });
+    report("Icosahedron", []() { return createIcosahedron(); });
+    report("Sphere 30 x 30", []() { return createSphere(30, 30); });
+    report("Sphere 200 x 200", []() { return createSphere(200, 200); });
+    report("Subdivided icosahedron 5", []() { return createSubdividedIcosahedron(5); });
+    report("Torus", []() { return createTorus(1.0f, 0.15f); });
+    report("Bezier patch, density 16", [&]() { return createBezierPatch(control_points, 4, 4, 16.0f); });
+    report("Teapot, density 2", []() { return createTeapot(2.0f); });
+    report("Teapot, density 8", []() { return createTeapot(8.0f); });
+    report("Teapot, adaptive 0.05", []() { return createAdaptiveTeapot(0.05f); });
+
+    printf("\nNormals after welding\n");
+    size_t n_non_finite = 0;
+    n_non_finite += checkNormals("Teapot, density 1", createTeapot(1.0f));
+    n_non_finite += checkNormals("Teapot, density 2", createTeapot(2.0f));
+    n_non_finite += checkNormals("Teapot, density 8", createTeapot(8.0f));
+    n_non_finite += checkNormals("Teapot, adaptive 0.05", createAdaptiveTeapot(0.05f));
+    return n_non_finite == 0 ? 0 : 1;
+}
@@ -0,0 +1,142 @@
+// Benchmark: creation time and peak memory of large meshes with each MeshStorage.
+// CPU only fills the arrays, CPU_AND_GPU fills them then uploads them, and GPU writes the vertices
+// and indices straight into mapped buffers, so a single copy of the mesh exists at any time.
+//
+// Every mesh and storage runs in its own process, started by running this program again, so the
+// memory freed by one case is not reused by the next. Peak memory is the growth of the maximum
+// resident set size of that process, from getrusage(), so the bench needs a POSIX system. With a
+// software rasterizer such as Mesa llvmpipe (LIBGL_ALWAYS_SOFTWARE=1), buffer objects live in
+// process memory and are included.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+
+#include <sys/resource.h>
+
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+#include <glad/glad.h>
+
+#include "Geometry.hpp"
+#include "Mesh.hpp"
+#include "Teapot.hpp"
+
+using namespace std;
+
+// Number of runs of each mesh and storage. The fastest is kept.
+static const int N_RUNS = 3;
+
+struct MeshCase
+{
+    const char* name;
+    function<Mesh(MeshStorage)> create;
+};
+
+static const MeshCase MESH_CASES[] = {
+    {"Sphere 1000 x 1000", [](MeshStorage storage) { return createSphere(1000, 1000, storage); }},
+    {"Sphere 2000 x 2000", [](MeshStorage storage) { return createSphere(2000, 2000, storage); }},
+    {"Torus 1000 x 1000", [](MeshStorage storage) { return createTorus(1.0f, 0.15f, 1000, 1000, storage); }},
+    // Only the CPU storages weld the patches, so they end up with fewer vertices.
+    {"Teapot, sample density 48", [](MeshStorage storage) { return createTeapot(48.0f, storage); }},
+};
+
+static const MeshStorage STORAGES[] = {MeshStorage::CPU, MeshStorage::CPU_AND_GPU, MeshStorage::GPU};
+static const char* STORAGE_NAMES[] = {"CPU", "CPU_AND_GPU", "GPU"};
+
+// Maximum resident set size of the process so far, in MiB.
+static double maxRssMib()
+{
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / (1024.0 * 1024.0);
+#else
+    return usage.ru_maxrss / 1024.0;
+#endif
+}
+
+// Create one mesh with one storage, and print the time and peak memory.
+static void runCase(const MeshCase& mesh_case, int storage_index)
+{
+    const MeshStorage storage = STORAGES[storage_index];
+    glFinish();
+    const double rss_before = maxRssMib();
+
+    double best_ms = 0.0;
+    size_t n_vertices = 0;
+    for (int run = 0; run < N_RUNS; ++run) {
+        // Uploads are only done once the driver has finished them.
+        const auto start = chrono::steady_clock::now();
+        {
+            const Mesh mesh = mesh_case.create(storage);
+            glFinish();
+            n_vertices = storage == MeshStorage::CPU ? mesh.vertices.size() : mesh.gpuVertexCount();
+        }
+        const chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+        if (run == 0 || elapsed.count() < best_ms)
+            best_ms = elapsed.count();
+    }
+
+    printf("  %-12s %9zu vertices %9.1f ms  peak +%7.1f MiB\n",
+           STORAGE_NAMES[storage_index], n_vertices, best_ms, maxRssMib() - rss_before);
+}
+
+int main(int argc, char** argv)
+{
+    const int n_cases = static_cast<int>(sizeof(MESH_CASES) / sizeof(MESH_CASES[0]));
+    const int n_storages = static_cast<int>(sizeof(STORAGES) / sizeof(STORAGES[0]));
+
+    // Without arguments, run every case in a new process.
+    if (argc < 3) {
+        printf("Mesh creation, best of %d runs, and peak resident memory above the start\n", N_RUNS);
+        for (int i = 0; i < n_cases; ++i) {
+            printf("%s\n", MESH_CASES[i].name);
+            fflush(stdout);
+            for (int s = 0; s < n_storages; ++s) {
+                const string command = string("\"") + argv[0] + "\" " + to_string(i) + " " + to_string(s);
+                if (system(command.c_str()) != 0)
+                    printf("  %-12s failed\n", STORAGE_NAMES[s]);
+                fflush(stdout);
+            }
+        }
+        return 0;
+    }
+
+    const int case_index = atoi(argv[1]);
+    const int storage_index = atoi(argv[2]);
+    if (case_index < 0 || case_index >= n_cases || storage_index < 0 || storage_index >= n_storages) {
+        printf("Usage: %s [case storage]\n", argv[0]);
+        return -1;
+    }
+
+    if (!glfwInit()) {
+        printf("Failed to initialize GLFW.\n");
+        return -1;
+    }
+
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(64, 64, "Benchmark", NULL, NULL);
+    if (!window) {
+        printf("Failed to create window.\n");
+        glfwTerminate();
+        return -1;
+    }
+
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader( (GLADloadproc)glfwGetProcAddress) ) {
+        printf("Failed to initialize OpenGL context.\n");
+        glfwTerminate();
+        return -1;
+    }
+
+    runCase(MESH_CASES[case_index], storage_index);
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+}
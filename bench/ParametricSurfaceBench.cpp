@@ -0,0 +1,89 @@
+// Benchmark: generation time of high resolution parametric surfaces.
+// Compares the per vertex sinf/cosf loop createSphere() used to run with the parallel generator, and
+// times the torus and a Bezier patch at about a million vertices. Meshes are only generated, so no
+// GL context is needed.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Geometry.hpp"
+#include "Mesh.hpp"
+
+using namespace std;
+using glm::vec2;
+using glm::vec3;
+
+static constexpr float PI = 3.14159f;
+
+// The sphere as it used to be generated: trigonometry for every vertex, growing the array, then
+// copying it to the mesh.
+static Mesh scalarSphere(int n_latitude, int n_longitude)
+{
+    const float phi_start =  PI * 0.5f - 0.01f;
+    const float phi_step  = -2.0f * phi_start / (n_latitude - 1);
+    const float theta_step = 2 * PI / (n_longitude - 1);
+
+    vector<Vertex> vertices;
+    float phi = phi_start;
+    for (int i = 0; i < n_latitude; ++i) {
+        float theta = 0.0f;
+        float v = static_cast<float>(i) / (n_latitude - 1);
+        for (int j = 0; j < n_longitude; ++j) {
+            vec3 r{cosf(phi) * sinf(theta), sinf(phi), cosf(phi) * cosf(theta)};
+            float u = static_cast<float>(j) / (n_longitude - 1);
+            vertices.emplace_back(r, r, vec2{u, v});
+            theta += theta_step;
+        }
+        phi += phi_step;
+    }
+
+    vector<unsigned int> indices;
+    triangulatePatch(indices, n_latitude, n_longitude);
+    return Mesh(move(vertices), move(indices));
+}
+
+// Run `func` several times and return the best time, in milliseconds.
+static double bestTime(const function<size_t()>& func, size_t& n_vertices)
+{
+    const int n_runs = 5;
+    double best = 1e30;
+    for (int run = 0; run < n_runs; ++run) {
+        const auto start = chrono::steady_clock::now();
+        n_vertices = func();
+        const auto stop = chrono::steady_clock::now();
+        const double ms = chrono::duration<double, milli>(stop - start).count();
+        best = ms < best ? ms : best;
+    }
+    return best;
+}
+
+static void report(const char* name, const function<size_t()>& func)
+{
+    size_t n_vertices = 0;
+    const double ms = bestTime(func, n_vertices);
+    printf("  %-36s %9zu vertices %9.2f ms\n", name, n_vertices, ms);
+}
+
+int main()
+{
+    // A gently curved 4x4 Bezier patch.
+    vector<vec3> control_points;
+    for (int i = 0; i < 4; ++i) {
+        for (int j = 0; j < 4; ++j)
+            control_points.emplace_back(i, (i == 1 || i == 2) && (j == 1 || j == 2) ? 1.0f : 0.0f, j);
+    }
+
+    printf("Parametric surface generation (best of 5 runs)\n");
+    report("Sphere 1000 x 1000, scalar vertices", []() { return scalarSphere(1000, 1000).vertices.size(); });
+    report("Sphere 1000 x 1000", []() { return createSphere(1000, 1000).vertices.size(); });
+    report("Torus 1000 x 1000", []() { return createTorus(1.0f, 0.15f, 1000, 1000).vertices.size(); });
+    report("Bezier patch, density 256", [&]() {
+        return createBezierPatch(control_points, 4, 4, 256.0f).vertices.size();
+    });
+}
@@ -0,0 +1,92 @@
+// Microbenchmark: TRS matrix composition.
+// Compares the matrix product path (getTranslation * getRotation * getScale) with the batched
+// composeTransforms() kernel, with and without normal matrices.
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Math.hpp"
+
+using namespace std;
+using glm::vec3;
+using glm::mat3;
+using glm::mat4;
+
+// Run `func` several times and return the best time per transformation, in nanoseconds.
+template <typename Func>
+static double bestTimePerItem(size_t n_items, Func&& func)
+{
+    const int n_runs = 20;
+    double best = 1e30;
+    for (int run = 0; run < n_runs; ++run) {
+        const auto start = chrono::steady_clock::now();
+        func();
+        const auto stop = chrono::steady_clock::now();
+        const double ns = chrono::duration<double, nano>(stop - start).count();
+        best = ns < best ? ns : best;
+    }
+    return best / n_items;
+}
+
+int main()
+{
+    const size_t n_transforms = 100000;
+
+    mt19937 rng(42);
+    uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    auto random_vec3 = [&]() { return vec3(dist(rng), dist(rng), dist(rng)); };
+
+    vector<vec3> pos(n_transforms), ori_x(n_transforms), ori_y(n_transforms), ori_z(n_transforms);
+    vector<vec3> scale(n_transforms);
+    for (size_t i = 0; i < n_transforms; ++i) {
+        pos[i] = random_vec3();
+        ori_x[i] = random_vec3();
+        ori_y[i] = random_vec3();
+        ori_z[i] = random_vec3();
+        scale[i] = random_vec3() + vec3(2.0f);
+    }
+
+    vector<mat4> transforms(n_transforms);
+    vector<mat3> normal_matrices(n_transforms);
+
+    const double ns_product = bestTimePerItem(n_transforms, [&]() {
+        for (size_t i = 0; i < n_transforms; ++i) {
+            transforms[i] = getTranslation(pos[i])
+                          * getRotation(ori_x[i], ori_y[i], ori_z[i])
+                          * getScale(scale[i]);
+        }
+    });
+
+    const double ns_product_normal = bestTimePerItem(n_transforms, [&]() {
+        for (size_t i = 0; i < n_transforms; ++i) {
+            transforms[i] = getTranslation(pos[i])
+                          * getRotation(ori_x[i], ori_y[i], ori_z[i])
+                          * getScale(scale[i]);
+            normal_matrices[i] = glm::transpose(glm::inverse(mat3(transforms[i])));
+        }
+    });
+
+    const double ns_batched = bestTimePerItem(n_transforms, [&]() {
+        composeTransforms(pos.data(), ori_x.data(), ori_y.data(), ori_z.data(), scale.data(),
+                          n_transforms, transforms.data());
+    });
+
+    const double ns_batched_normal = bestTimePerItem(n_transforms, [&]() {
+        composeTransforms(pos.data(), ori_x.data(), ori_y.data(), ori_z.data(), scale.data(),
+                          n_transforms, transforms.data(), normal_matrices.data());
+    });
+
+    printf("TRS composition, %zu transformations (best of 20 runs, ns per transformation)\n",
+           n_transforms);
+    printf("  matrix product                    %8.2f\n", ns_product);
+    printf("  matrix product + inverse()        %8.2f\n", ns_product_normal);
+    printf("  composeTransforms                 %8.2f\n", ns_batched);
+    printf("  composeTransforms + normal matrix %8.2f\n", ns_batched_normal);
+
+    // Keep the results alive.
+    return transforms[n_transforms / 2][3][0] > 1e30f ? 1 : 0;
+}
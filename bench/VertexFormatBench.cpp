@@ -0,0 +1,175 @@
+// Benchmark: memory and vertex fetch cost of the vertex formats.
+// Draws high density teapots and spheres with rasterization disabled, so only vertex fetch and
+// shading are measured, once with 32-byte float vertices and 32-bit indices, and once with packed
+// 16-byte vertices and 16-bit indices when possible.
+//
+// Runs on any GL 4.0 context. For a software rasterizer, run it with LIBGL_ALWAYS_SOFTWARE=1 to
+// select Mesa llvmpipe.
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "Geometry.hpp"
+#include "Mesh.hpp"
+#include "Teapot.hpp"
+
+using namespace std;
+using glm::mat4;
+
+// Read every attribute, so none of the vertex fetch can be optimized away.
+static const char* VERT_SHADER = R"(#version 400 core
+layout (location = 0) in vec3 in_pos;
+layout (location = 1) in vec3 in_normal;
+layout (location = 2) in vec2 in_tex;
+out vec4 color;
+uniform mat4 u_model;
+void main()
+{
+    gl_Position = u_model * vec4(in_pos, 1.0);
+    color = vec4(in_normal, in_tex.x + in_tex.y);
+}
+)";
+
+static const char* FRAG_SHADER = R"(#version 400 core
+in vec4 color;
+out vec4 FragColor;
+void main()
+{
+    FragColor = color;
+}
+)";
+
+static unsigned int createProgram()
+{
+    unsigned int vert_shader = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(vert_shader, 1, &VERT_SHADER, NULL);
+    glCompileShader(vert_shader);
+
+    unsigned int frag_shader = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(frag_shader, 1, &FRAG_SHADER, NULL);
+    glCompileShader(frag_shader);
+
+    unsigned int program = glCreateProgram();
+    glAttachShader(program, vert_shader);
+    glAttachShader(program, frag_shader);
+    glLinkProgram(program);
+
+    int success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        char info_log[512];
+        glGetProgramInfoLog(program, 512, NULL, info_log);
+        printf("Shader program linking failed: \n%s\n", info_log);
+    }
+
+    glDeleteShader(vert_shader);
+    glDeleteShader(frag_shader);
+    return program;
+}
+
+// Number of timed runs of each format. The fastest is kept, as the least disturbed by other
+// processes.
+static const int N_RUNS = 5;
+
+// Draw the mesh `n_draws` times per run and return the time per draw of the fastest run, in
+// milliseconds.
+// Timed on the CPU between two glFinish(), as in the vertex normal bench: llvmpipe runs draws
+// when they are flushed, so GL_TIME_ELAPSED queries read close to 0 there.
+static double timeDraws(unsigned int program, Mesh& mesh, int n_draws)
+{
+    // Quantized positions are mapped back to object space by the model matrix.
+    const mat4 model = mesh.dequantization();
+    glUseProgram(program);
+    glUniformMatrix4fv(glGetUniformLocation(program, "u_model"), 1, GL_FALSE, &model[0][0]);
+
+    // Warm up.
+    mesh.draw();
+    glFinish();
+
+    double best_ms = 0.0;
+    for (int run = 0; run < N_RUNS; ++run) {
+        const auto start = chrono::steady_clock::now();
+        for (int i = 0; i < n_draws; ++i)
+            mesh.draw();
+        glFinish();
+        const chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+        if (run == 0 || elapsed.count() < best_ms)
+            best_ms = elapsed.count();
+    }
+
+    return best_ms / n_draws;
+}
+
+// Compare both formats for one mesh.
+static void compareFormats(const char* name, unsigned int program, const function<Mesh()>& create)
+{
+    MeshUploadOptions options;
+    Mesh float_mesh = create();
+    float_mesh.pushToGpu(options);
+    options.format = VertexFormat::PACKED;
+    Mesh packed_mesh = create();
+    packed_mesh.pushToGpu(options);
+
+    const int n_draws = 20;
+    const double ms_float = timeDraws(program, float_mesh, n_draws);
+    const double ms_packed = timeDraws(program, packed_mesh, n_draws);
+
+    // Every index fetches one vertex, so this is the vertex traffic of a draw without cache hits.
+    const double float_fetch = float_mesh.indices.size() * sizeof(Vertex);
+    const double packed_fetch = packed_mesh.indices.size() * sizeof(PackedVertex);
+
+    printf("%s, %8zu vertices, %8zu indices\n",
+           name, float_mesh.vertices.size(), float_mesh.indices.size());
+    printf("  float32  %9.1f KiB  fetch %9.1f KiB/draw  %8.3f ms/draw\n",
+           float_mesh.gpuSize() / 1024.0, float_fetch / 1024.0, ms_float);
+    printf("  packed   %9.1f KiB  fetch %9.1f KiB/draw  %8.3f ms/draw (%.1f%% saved)\n",
+           packed_mesh.gpuSize() / 1024.0, packed_fetch / 1024.0, ms_packed,
+           100.0 * (1.0 - ms_packed / ms_float));
+}
+
+int main()
+{
+    if (!glfwInit()) {
+        printf("Failed to initialize GLFW.\n");
+        return -1;
+    }
+
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(64, 64, "Benchmark", NULL, NULL);
+    if (!window) {
+        printf("Failed to create window.\n");
+        glfwTerminate();
+        return -1;
+    }
+
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader( (GLADloadproc)glfwGetProcAddress) ) {
+        printf("Failed to initialize OpenGL context.\n");
+        glfwTerminate();
+        return -1;
+    }
+    printf("OpenGL renderer: %s\n", glGetString(GL_RENDERER));
+
+    // Only the vertex stage runs.
+    glEnable(GL_RASTERIZER_DISCARD);
+
+    const unsigned int program = createProgram();
+
+    compareFormats("Teapot, sample density  8", program, []() { return createTeapot(8.0f); });
+    compareFormats("Teapot, sample density 16", program, []() { return createTeapot(16.0f); });
+    compareFormats("Sphere, 200 x 200        ", program, []() { return createSphere(200, 200); });
+    compareFormats("Sphere, 1000 x 1000      ", program, []() { return createSphere(1000, 1000); });
+
+    glDeleteProgram(program);
+    glfwDestroyWindow(window);
+    glfwTerminate();
+}
@@ -0,0 +1,197 @@
+// Benchmark: vertex stage cost of the Phong normal matrix.
+// Draws a high density teapot with rasterization disabled, so only vertex shading is measured, and
+// compares computing transpose(inverse(mat3(u_view * u_model))) per vertex with a normal matrix
+// uploaded once per draw.
+//
+// Runs on any GL 4.0 context. For a software rasterizer, run it with LIBGL_ALWAYS_SOFTWARE=1 to
+// select Mesa llvmpipe.
+
+#include <chrono>
+#include <cstdio>
+
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "Mesh.hpp"
+#include "Teapot.hpp"
+
+using namespace std;
+using glm::vec3;
+using glm::mat3;
+using glm::mat4;
+
+static const char* VERT_SHADER_HEADER = R"(#version 400 core
+layout (location = 0) in vec3 in_pos;
+layout (location = 1) in vec3 in_normal;
+layout (location = 2) in vec2 in_tex;
+out vec3 P;
+out vec3 N;
+out vec2 tex_coords;
+uniform mat4 u_model;
+uniform mat4 u_view;
+uniform mat4 u_projection;
+uniform mat4 u_model_view;
+uniform mat3 u_normal_matrix;
+)";
+
+// Normal matrix computed for every vertex, as Phong.vert used to do.
+static const char* VERT_SHADER_PER_VERTEX = R"(
+void main()
+{
+    vec4 view_pos = u_view * u_model * vec4(in_pos, 1.0);
+    P = vec3(view_pos) / view_pos.w;
+    N = normalize(transpose(inverse(mat3(u_view * u_model))) * in_normal);
+    gl_Position = u_projection * view_pos;
+    tex_coords = in_tex;
+}
+)";
+
+// Normal and model-view matrices uploaded once per draw.
+static const char* VERT_SHADER_PER_DRAW = R"(
+void main()
+{
+    vec4 view_pos = u_model_view * vec4(in_pos, 1.0);
+    P = vec3(view_pos) / view_pos.w;
+    N = normalize(u_normal_matrix * in_normal);
+    gl_Position = u_projection * view_pos;
+    tex_coords = in_tex;
+}
+)";
+
+// Consume every output, so none of the vertex work can be optimized away.
+static const char* FRAG_SHADER = R"(#version 400 core
+in vec3 P;
+in vec3 N;
+in vec2 tex_coords;
+out vec4 FragColor;
+void main()
+{
+    FragColor = vec4(P + N, tex_coords.x + tex_coords.y);
+}
+)";
+
+static unsigned int createProgram(const char* vert_body)
+{
+    const char* vert_sources[] = {VERT_SHADER_HEADER, vert_body};
+    unsigned int vert_shader = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(vert_shader, 2, vert_sources, NULL);
+    glCompileShader(vert_shader);
+
+    unsigned int frag_shader = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(frag_shader, 1, &FRAG_SHADER, NULL);
+    glCompileShader(frag_shader);
+
+    unsigned int program = glCreateProgram();
+    glAttachShader(program, vert_shader);
+    glAttachShader(program, frag_shader);
+    glLinkProgram(program);
+
+    int success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        char info_log[512];
+        glGetProgramInfoLog(program, 512, NULL, info_log);
+        printf("Shader program linking failed: \n%s\n", info_log);
+    }
+
+    glDeleteShader(vert_shader);
+    glDeleteShader(frag_shader);
+    return program;
+}
+
+// Number of timed runs of each variant. The fastest is kept, as the least disturbed by other
+// processes.
+static const int N_RUNS = 5;
+
+// Draw the mesh `n_draws` times per run and return the time per draw of the fastest run, in
+// milliseconds.
+// Timed on the CPU between two glFinish(): llvmpipe runs draws when they are flushed, after a
+// GL_TIME_ELAPSED query has ended, so queries read close to 0 there.
+static double timeDraws(unsigned int program, Mesh& mesh, int n_draws)
+{
+    const mat4 model(1.0f);
+    const mat4 view(1.0f);
+    const mat4 projection(1.0f);
+    const mat4 model_view = view * model;
+    const mat3 normal_matrix = glm::transpose(glm::inverse(mat3(model_view)));
+
+    glUseProgram(program);
+    glUniformMatrix4fv(glGetUniformLocation(program, "u_model"), 1, GL_FALSE, &model[0][0]);
+    glUniformMatrix4fv(glGetUniformLocation(program, "u_view"), 1, GL_FALSE, &view[0][0]);
+    glUniformMatrix4fv(glGetUniformLocation(program, "u_projection"), 1, GL_FALSE, &projection[0][0]);
+    glUniformMatrix4fv(glGetUniformLocation(program, "u_model_view"), 1, GL_FALSE, &model_view[0][0]);
+    glUniformMatrix3fv(glGetUniformLocation(program, "u_normal_matrix"), 1, GL_FALSE, &normal_matrix[0][0]);
+
+    // Warm up.
+    mesh.draw();
+    glFinish();
+
+    double best_ms = 0.0;
+    for (int run = 0; run < N_RUNS; ++run) {
+        const auto start = chrono::steady_clock::now();
+        for (int i = 0; i < n_draws; ++i)
+            mesh.draw();
+        glFinish();
+        const chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+        if (run == 0 || elapsed.count() < best_ms)
+            best_ms = elapsed.count();
+    }
+
+    return best_ms / n_draws;
+}
+
+int main()
+{
+    if (!glfwInit()) {
+        printf("Failed to initialize GLFW.\n");
+        return -1;
+    }
+
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(64, 64, "Benchmark", NULL, NULL);
+    if (!window) {
+        printf("Failed to create window.\n");
+        glfwTerminate();
+        return -1;
+    }
+
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader( (GLADloadproc)glfwGetProcAddress) ) {
+        printf("Failed to initialize OpenGL context.\n");
+        glfwTerminate();
+        return -1;
+    }
+    printf("OpenGL renderer: %s\n", glGetString(GL_RENDERER));
+
+    // Only the vertex stage runs.
+    glEnable(GL_RASTERIZER_DISCARD);
+
+    const unsigned int program_per_vertex = createProgram(VERT_SHADER_PER_VERTEX);
+    const unsigned int program_per_draw = createProgram(VERT_SHADER_PER_DRAW);
+
+    const float densities[] = {2.0f, 8.0f, 16.0f};
+    for (const float density : densities) {
+        Mesh teapot = createTeapot(density);
+        teapot.pushToGpu();
+
+        const int n_draws = 50;
+        const double ms_per_vertex = timeDraws(program_per_vertex, teapot, n_draws);
+        const double ms_per_draw = timeDraws(program_per_draw, teapot, n_draws);
+
+        printf("Teapot, sample density %4.1f, %8zu vertices, %8zu indices\n",
+               density, teapot.vertices.size(), teapot.indices.size());
+        printf("  normal matrix per vertex  %8.3f ms/draw\n", ms_per_vertex);
+        printf("  normal matrix per draw    %8.3f ms/draw (%.1f%% saved)\n",
+               ms_per_draw, 100.0 * (1.0 - ms_per_draw / ms_per_vertex));
+    }
+
+    glDeleteProgram(program_per_vertex);
+    glDeleteProgram(program_per_draw);
+    glfwDestroyWindow(window);
+    glfwTerminate();
+}
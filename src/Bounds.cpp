@@ -0,0 +1,123 @@
+#include "Bounds.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glm/glm.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define BOUNDS_USE_SSE
+#endif
+
+using glm::vec3;
+using glm::vec4;
+using glm::mat4;
+
+using namespace std;
+
+Aabb computeAabb(const vector<Vertex>& vertices)
+{
+    if (vertices.empty())
+        return Aabb();
+
+    Aabb aabb{vertices[0].pos, vertices[0].pos};
+    for (const auto& v : vertices) {
+        aabb.min = glm::min(aabb.min, v.pos);
+        aabb.max = glm::max(aabb.max, v.pos);
+    }
+    return aabb;
+}
+
+BoundingSphere computeBoundingSphere(const vector<Vertex>& vertices, const Aabb& aabb)
+{
+    BoundingSphere sphere;
+    sphere.center = 0.5f * (aabb.min + aabb.max);
+
+    float max_distance2 = 0.0f;
+    for (const auto& v : vertices) {
+        const vec3 d = v.pos - sphere.center;
+        max_distance2 = max(max_distance2, glm::dot(d, d));
+    }
+    sphere.radius = sqrt(max_distance2);
+    return sphere;
+}
+
+vec4 transformBoundingSphere(const BoundingSphere& sphere, const mat4& transformation)
+{
+    const vec3 center = vec3(transformation * vec4(sphere.center, 1.0f));
+    const float scale2 = max({glm::dot(vec3(transformation[0]), vec3(transformation[0])),
+                              glm::dot(vec3(transformation[1]), vec3(transformation[1])),
+                              glm::dot(vec3(transformation[2]), vec3(transformation[2]))});
+    return vec4(center, sphere.radius * sqrt(scale2));
+}
+
+Frustum extractFrustum(const mat4& view_projection)
+{
+    // Clip space coordinates are within [-w, w], so each plane is a sum or difference of the
+    // last row of the matrix and one of the others.
+    const mat4 rows = glm::transpose(view_projection);
+
+    Frustum frustum;
+    frustum.planes[0] = rows[3] + rows[0];
+    frustum.planes[1] = rows[3] - rows[0];
+    frustum.planes[2] = rows[3] + rows[1];
+    frustum.planes[3] = rows[3] - rows[1];
+    frustum.planes[4] = rows[3] + rows[2];
+    frustum.planes[5] = rows[3] - rows[2];
+
+    for (auto& plane : frustum.planes)
+        plane = plane * (1.0f / glm::length(vec3(plane)));
+    return frustum;
+}
+
+// Whether a sphere is on the inner side of every plane, or crosses it.
+static bool isSphereVisible(const Frustum& frustum, const vec4& sphere)
+{
+    for (const auto& plane : frustum.planes) {
+        if (glm::dot(vec3(plane), vec3(sphere)) + plane.w + sphere.w < 0.0f)
+            return false;
+    }
+    return true;
+}
+
+void cullSpheres(const Frustum& frustum, const vec4* spheres, size_t count, uint8_t* out_visible)
+{
+    size_t i = 0;
+
+#ifdef BOUNDS_USE_SSE
+    static_assert(sizeof(vec4) == 4 * sizeof(float), "vec4 must be tightly packed");
+
+    // Broadcast each plane coefficient once.
+    __m128 planes[6][4];
+    for (int p = 0; p < 6; ++p) {
+        for (int c = 0; c < 4; ++c)
+            planes[p][c] = _mm_set1_ps(frustum.planes[p][c]);
+    }
+    const __m128 zero = _mm_setzero_ps();
+
+    for (; i + 4 <= count; i += 4) {
+        // Transpose four spheres to one register per component.
+        __m128 x = _mm_loadu_ps(&spheres[i][0]);
+        __m128 y = _mm_loadu_ps(&spheres[i + 1][0]);
+        __m128 z = _mm_loadu_ps(&spheres[i + 2][0]);
+        __m128 r = _mm_loadu_ps(&spheres[i + 3][0]);
+        _MM_TRANSPOSE4_PS(x, y, z, r);
+
+        // Visible while the signed distance to each plane is at least minus the radius.
+        __m128 inside = _mm_cmpeq_ps(zero, zero);
+        for (const auto& plane : planes) {
+            const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(plane[0], x), _mm_mul_ps(plane[1], y)),
+                                               _mm_add_ps(_mm_mul_ps(plane[2], z), plane[3]));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, r), zero));
+        }
+
+        const int mask = _mm_movemask_ps(inside);
+        for (int k = 0; k < 4; ++k)
+            out_visible[i + k] = static_cast<uint8_t>((mask >> k) & 1);
+    }
+#endif // BOUNDS_USE_SSE
+
+    for (; i < count; ++i)
+        out_visible[i] = isSphereVisible(frustum, spheres[i]) ? 1 : 0;
+}
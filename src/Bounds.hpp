@@ -0,0 +1,57 @@
+#ifndef BOUNDS_HPP
+#define BOUNDS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include "Vertex.hpp"
+
+// Axis aligned bounding box.
+struct Aabb
+{
+    glm::vec3 min{0.0f};
+    glm::vec3 max{0.0f};
+};
+
+// Bounding sphere. An infinite radius bounds everything, and is never culled.
+struct BoundingSphere
+{
+    glm::vec3 center{0.0f};
+    float radius = 0.0f;
+};
+
+// Box of a list of vertices, empty at the origin if there are none.
+Aabb computeAabb(const std::vector<Vertex>& vertices);
+
+// Sphere of a list of vertices, centered on their box, with the distance to the farthest vertex
+// as radius.
+BoundingSphere computeBoundingSphere(const std::vector<Vertex>& vertices, const Aabb& aabb);
+
+// Sphere enclosing a transformed sphere, packed as (center, radius) for cullSpheres(). The radius
+// is scaled by the largest scale factor of the transformation.
+glm::vec4 transformBoundingSphere(const BoundingSphere& sphere, const glm::mat4& transformation);
+
+// Planes of a view frustum, as (normal, distance) with normals pointing inside: point p is in the
+// frustum if dot(plane, vec4(p, 1)) >= 0 for the 6 planes.
+struct Frustum
+{
+    // Left, right, bottom, top, near and far planes.
+    glm::vec4 planes[6];
+};
+
+// Frustum of a view-projection matrix, in the space the matrix transforms from. Planes are
+// normalized, so plane equations give distances.
+Frustum extractFrustum(const glm::mat4& view_projection);
+
+// Test `count` spheres packed as (center, radius) against a frustum, and set out_visible[i] to 1
+// if sphere i may be in it, 0 otherwise. Spheres near frustum corners may pass the test while
+// being outside.
+// Uses SSE when available, four spheres at a time.
+void cullSpheres(const Frustum& frustum, const glm::vec4* spheres, size_t count, uint8_t* out_visible);
+
+#endif // BOUNDS_HPP
@@ -50,6 +50,11 @@ const mat4& Camera::projection() const
     return is_perspective_ ? perspective_projection_ : parallel_projection_;
 }
 
+Frustum Camera::frustum() const
+{
+    return extractFrustum(projection() * view_);
+}
+
 void Camera::updateView()
 {
     // View matrix is the inverse of:
@@ -4,6 +4,8 @@
 #include <glm/mat4x4.hpp>
 #include <glm/vec3.hpp>
 
+#include "Bounds.hpp"
+
 class Camera
 {
 public:
@@ -21,6 +23,8 @@ public:
     // Get transformations by reference.
     const glm::mat4& view() const;
     const glm::mat4& projection() const;
+    // World space frustum of the current view and projection.
+    Frustum frustum() const;
 
     // Update view transformation.
     // TODO: Maybe this should be a private method...
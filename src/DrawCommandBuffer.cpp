@@ -0,0 +1,50 @@
+#include "DrawCommandBuffer.hpp"
+
+#include <cstring>
+
+#include <glad/glad.h>
+
+#include "StreamBuffer.hpp"
+
+using namespace std;
+
+// Alignment of the commands in the stream buffer.
+static const size_t COMMAND_ALIGNMENT = 16;
+
+DrawCommandBuffer::DrawCommandBuffer():
+    id_(0), offset_(0), size_(0)
+{
+}
+
+size_t DrawCommandBuffer::streamSize(size_t count)
+{
+    return count * sizeof(DrawCommand) + COMMAND_ALIGNMENT;
+}
+
+void DrawCommandBuffer::update(StreamBuffer& stream, const vector<DrawCommand>& commands)
+{
+    size_ = commands.size();
+    if (commands.empty())
+        return;
+
+    const size_t size = commands.size() * sizeof(DrawCommand);
+    const StreamBuffer::Range range = stream.allocate(size, COMMAND_ALIGNMENT);
+    memcpy(range.data, commands.data(), size);
+    id_ = stream.getId();
+    offset_ = range.offset;
+}
+
+size_t DrawCommandBuffer::size() const
+{
+    return size_;
+}
+
+size_t DrawCommandBuffer::offset() const
+{
+    return offset_;
+}
+
+void DrawCommandBuffer::bind() const
+{
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, id_);
+}
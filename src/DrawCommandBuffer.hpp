@@ -0,0 +1,51 @@
+#ifndef DRAW_COMMAND_BUFFER_HPP
+#define DRAW_COMMAND_BUFFER_HPP
+
+#include <cstddef>
+#include <vector>
+
+class StreamBuffer;
+
+// Indirect draw command, laid out as glMultiDrawElementsIndirect expects it.
+struct DrawCommand
+{
+    unsigned int count;
+    unsigned int instance_count;
+    unsigned int first_index;
+    int base_vertex;
+    unsigned int base_instance;
+};
+
+// Indirect draw commands of a frame, written to the region of the frame in a stream buffer.
+class DrawCommandBuffer
+{
+private:
+    // Stream buffer holding the commands of the frame, and offset of the first one in it.
+    unsigned int id_;
+    size_t offset_;
+    // Number of commands of the frame.
+    size_t size_;
+
+public:
+    DrawCommandBuffer();
+    ~DrawCommandBuffer() = default;
+
+    DrawCommandBuffer(const DrawCommandBuffer&) = delete;
+    DrawCommandBuffer& operator=(const DrawCommandBuffer&) = delete;
+
+    // Bytes taken by `count` commands in a stream buffer.
+    static size_t streamSize(size_t count);
+
+    // Write the commands of the frame to the stream buffer, which must be between beginFrame()
+    // and endWrites().
+    void update(StreamBuffer& stream, const std::vector<DrawCommand>& commands);
+
+    // Number of commands in the buffer.
+    size_t size() const;
+    // Offset of the first command from the start of the bound buffer, in bytes.
+    size_t offset() const;
+    // Bind the buffer to the indirect draw binding point.
+    void bind() const;
+};
+
+#endif // DRAW_COMMAND_BUFFER_HPP
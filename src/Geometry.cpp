@@ -1,11 +1,18 @@
 #include "Geometry.hpp"
 
+#include <algorithm>
+#include <array>
+#include <cassert>
 #include <cmath>
+#include <map>
 #include <tuple>   // For std::tuple
+#include <utility>
 
 #include <glm/glm.hpp>
 
+#include "GeometryTables.hpp"
 #include "Math.hpp"
+#include "Parallel.hpp"
 
 using namespace std;
 using glm::vec2;
@@ -14,6 +21,67 @@ using glm::normalize;
 
 static constexpr float PI = 3.14159f;
 
+// Sines and cosines of evenly spaced angles, so separable surfaces compute them once per row and
+// once per column rather than for every vertex.
+struct TrigTable
+{
+    TrigTable(float first_angle, float step, int count):
+        sin(count),
+        cos(count)
+    {
+        for (int i = 0; i < count; ++i) {
+            const float angle = first_angle + i * step;
+            sin[i] = sinf(angle);
+            cos[i] = cosf(angle);
+        }
+    }
+
+    vector<float> sin;
+    vector<float> cos;
+};
+
+// Subdivided icosahedra small enough to be built by the compiler.
+static constexpr auto ICOSPHERE_0 = makeIcosphereTable<0>();
+static constexpr auto ICOSPHERE_1 = makeIcosphereTable<1>();
+static constexpr auto ICOSPHERE_2 = makeIcosphereTable<2>();
+static constexpr auto ICOSPHERE_3 = makeIcosphereTable<MAX_TABLE_ICOSPHERE_ORDER>();
+
+static_assert(sizeof(VertexData) == sizeof(Vertex), "VertexData must have the layout of a Vertex");
+
+static Vertex toVertex(const VertexData& v)
+{
+    return Vertex(vec3(v.pos[0], v.pos[1], v.pos[2]),
+                  vec3(v.normal[0], v.normal[1], v.normal[2]),
+                  vec2(v.tex[0], v.tex[1]));
+}
+
+// Build a mesh from compile time tables, filling its arrays directly.
+template <size_t N_VERTICES>
+static Mesh meshFromTables(const array<VertexData, N_VERTICES>& vertex_table)
+{
+    Mesh mesh;
+    mesh.vertices.reserve(N_VERTICES);
+    for (const auto& v : vertex_table)
+        mesh.vertices.push_back(toVertex(v));
+    return mesh;
+}
+
+template <size_t N_VERTICES, size_t N_INDICES>
+static Mesh meshFromTables(const array<VertexData, N_VERTICES>& vertex_table,
+                           const array<unsigned int, N_INDICES>& index_table)
+{
+    Mesh mesh = meshFromTables(vertex_table);
+    mesh.indices.assign(index_table.begin(), index_table.end());
+    return mesh;
+}
+
+// Below this amount of vertices or triangles, subdivision runs on the calling thread.
+static constexpr size_t MIN_SUBDIVISION_ITEMS_PER_TASK = 16384;
+
+// Distance from the patch edges, in parameter space, at which degenerate samples take their
+// normal. Same value as in BezierPatch.tese.
+static constexpr float EDGE_OFFSET = 1e-3f;
+
 // Generate triangle indices for a rectangular patch and append it to the input indicex list.
 //
 // . . . .
@@ -22,13 +90,15 @@ static constexpr float PI = 3.14159f;
 //
 // Order of vertices: a triangle's last vertex (OpenGL's provoking vertex by default) is the same
 // between neighbouring triangles. This makes for a pleasant flat shading.
-static void triangulatePatch(vector<unsigned int>& indices,
-                             int rows,
-                             int cols,
-                             bool wrap_horizontally = false,
-                             bool wrap_vertically = false,
-                             unsigned int first_index = 0)
+void triangulatePatch(vector<unsigned int>& indices,
+                      int rows,
+                      int cols,
+                      bool wrap_horizontally,
+                      bool wrap_vertically,
+                      unsigned int first_index)
 {
+    indices.reserve(indices.size() + 6 * static_cast<size_t>(rows) * cols);
+
     // For each vertex position, append the corresponding right-hand oriented triangles.
     for (int i = 0; i < rows - 1; ++i) {
         for (int j = 0; j < cols - 1; ++j) {
@@ -101,219 +171,149 @@ static void triangulatePatch(vector<unsigned int>& indices,
 
 
 // Subdivide each triangle in a mesh.
+//
+// Every edge is split once at its midpoint, and the new vertex is shared by the triangles on both
+// sides. Edges are gathered in a table bucketed by their lowest vertex and sorted by their highest
+// one, which numbers the unique edges without any hashing.
 void subdivide(Mesh& mesh, bool project_onto_unit_sphere)
 {
     assert(!mesh.indices.empty());
     assert(mesh.indices.size() % 3 == 0);
 
-    const auto initial_index_count = mesh.indices.size();
-
-    vector<unsigned int> new_indices;
-    new_indices.reserve(4 * initial_index_count);
-
-    for (int tri_index_slot = 0; tri_index_slot < initial_index_count; tri_index_slot += 3) {
-        // Retrieve triangle data.
-        const unsigned int index[3] = {
-            mesh.indices.at(tri_index_slot),
-            mesh.indices.at(tri_index_slot + 1),
-            mesh.indices.at(tri_index_slot + 2)
-        };
-        const vec3 tri_pos[3] = {
-            mesh.vertices.at(index[0]).pos,
-            mesh.vertices.at(index[1]).pos,
-            mesh.vertices.at(index[2]).pos
-        };
-
-        // Compute mean points between vertices.
-        vec3 new_pos[3] = {
-            (tri_pos[0] + tri_pos[1]) * 0.5f,
-            (tri_pos[1] + tri_pos[2]) * 0.5f,
-            (tri_pos[2] + tri_pos[0]) * 0.5f
-        };
-
-        unsigned int previous_vertex_count = mesh.vertices.size();
-
-        if (project_onto_unit_sphere) {
-            for (auto& p : new_pos) {
-                p = normalize(p);
-                mesh.vertices.emplace_back(p, p);
+    const auto& indices = mesh.indices;
+    const size_t n_slots = indices.size();
+    const size_t n_triangles = n_slots / 3;
+    const size_t n_vertices = mesh.vertices.size();
+
+    // Edge e of a triangle goes from its vertex e to its vertex (e + 1) % 3.
+    auto edgeEnds = [&indices](size_t slot) {
+        const size_t first_slot = slot - slot % 3;
+        const unsigned int a = indices[slot];
+        const unsigned int b = indices[first_slot + (slot + 1) % 3];
+        return a < b ? make_pair(a, b) : make_pair(b, a);
+    };
+
+    // Bucket the edge slots by lowest vertex (counting sort).
+    vector<unsigned int> bucket_begin(n_vertices + 1, 0);
+    for (size_t slot = 0; slot < n_slots; ++slot)
+        bucket_begin[edgeEnds(slot).first + 1]++;
+    for (size_t v = 0; v < n_vertices; ++v)
+        bucket_begin[v + 1] += bucket_begin[v];
+
+    vector<unsigned int> bucket_slots(n_slots);
+    {
+        vector<unsigned int> cursor(bucket_begin.begin(), bucket_begin.end() - 1);
+        for (size_t slot = 0; slot < n_slots; ++slot)
+            bucket_slots[cursor[edgeEnds(slot).first]++] = static_cast<unsigned int>(slot);
+    }
+
+    // Sort each bucket by highest vertex, and count its unique edges.
+    vector<unsigned int> first_midpoint(n_vertices + 1, 0);
+    parallelFor(0, n_vertices, MIN_SUBDIVISION_ITEMS_PER_TASK, [&](size_t begin, size_t end) {
+        for (size_t v = begin; v < end; ++v) {
+            const auto bucket_first = bucket_slots.begin() + bucket_begin[v];
+            const auto bucket_last = bucket_slots.begin() + bucket_begin[v + 1];
+            sort(bucket_first, bucket_last, [&](unsigned int a, unsigned int b) {
+                return edgeEnds(a).second < edgeEnds(b).second;
+            });
+
+            unsigned int n_unique = 0;
+            for (auto it = bucket_first; it != bucket_last; ++it) {
+                if (it == bucket_first || edgeEnds(*it).second != edgeEnds(*(it - 1)).second)
+                    n_unique++;
             }
+            first_midpoint[v + 1] = n_unique;
         }
-        else {
-            for (const auto& p : new_pos) {
-                mesh.vertices.emplace_back(p);
+    });
+
+    first_midpoint[0] = static_cast<unsigned int>(n_vertices);
+    for (size_t v = 0; v < n_vertices; ++v)
+        first_midpoint[v + 1] += first_midpoint[v];
+    const size_t n_new_vertices = first_midpoint[n_vertices];
+
+    // Create one midpoint per unique edge, and record it for every slot of the edge.
+    mesh.vertices.resize(n_new_vertices);
+    vector<unsigned int> midpoint_of_slot(n_slots);
+    parallelFor(0, n_vertices, MIN_SUBDIVISION_ITEMS_PER_TASK, [&](size_t begin, size_t end) {
+        for (size_t v = begin; v < end; ++v) {
+            unsigned int midpoint = first_midpoint[v] - 1;
+            unsigned int previous_end = static_cast<unsigned int>(-1);
+            for (unsigned int i = bucket_begin[v]; i < bucket_begin[v + 1]; ++i) {
+                const unsigned int slot = bucket_slots[i];
+                const auto ends = edgeEnds(slot);
+                if (ends.second != previous_end) {
+                    previous_end = ends.second;
+                    midpoint++;
+
+                    const vec3 p = (mesh.vertices[ends.first].pos + mesh.vertices[ends.second].pos) * 0.5f;
+                    if (project_onto_unit_sphere)
+                        mesh.vertices[midpoint] = Vertex(normalize(p), normalize(p));
+                    else
+                        mesh.vertices[midpoint] = Vertex(p);
+                }
+                midpoint_of_slot[slot] = midpoint;
             }
         }
+    });
+
+    // Replace each triangle with four.
+    vector<unsigned int> new_indices(4 * n_slots);
+    parallelFor(0, n_triangles, MIN_SUBDIVISION_ITEMS_PER_TASK, [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; ++t) {
+            const unsigned int* index = &indices[3*t];
+            const unsigned int* new_pos_index = &midpoint_of_slot[3*t];
+            unsigned int* triangles = &new_indices[12*t];
+
+            // Top triangle.
+            triangles[0] = index[0];
+            triangles[1] = new_pos_index[0];
+            triangles[2] = new_pos_index[2];
+            // Left triangle.
+            triangles[3] = new_pos_index[0];
+            triangles[4] = index[1];
+            triangles[5] = new_pos_index[1];
+            // Right triangle.
+            triangles[6] = new_pos_index[2];
+            triangles[7] = new_pos_index[1];
+            triangles[8] = index[2];
+            // Middle triangle.
+            triangles[9] = new_pos_index[0];
+            triangles[10] = new_pos_index[1];
+            triangles[11] = new_pos_index[2];
+        }
+    });
 
-        // Define new triangles.
-        const unsigned int new_pos_index[3] = {
-            previous_vertex_count,
-            previous_vertex_count + 1,
-            previous_vertex_count + 2
-        };
-
-        // Top triangle.
-        new_indices.push_back(index[0]);
-        new_indices.push_back(new_pos_index[0]);
-        new_indices.push_back(new_pos_index[2]);
-        // Left triangle.
-        new_indices.push_back(new_pos_index[0]);
-        new_indices.push_back(index[1]);
-        new_indices.push_back(new_pos_index[1]);
-        // Right triangle.
-        new_indices.push_back(new_pos_index[2]);
-        new_indices.push_back(new_pos_index[1]);
-        new_indices.push_back(index[2]);
-        // Middle triangle.
-        new_indices.push_back(new_pos_index[0]);
-        new_indices.push_back(new_pos_index[1]);
-        new_indices.push_back(new_pos_index[2]);
-    }
-
-    // Copy new indices to the mesh.
-    mesh.indices.clear();
-    mesh.indices.reserve(new_indices.size());
-    for (const auto& ind : new_indices) {
-        mesh.indices.push_back(ind);
-    }
+    mesh.indices.swap(new_indices);
 }
 
 
 Mesh createCubeWithoutIndices()
 {
-    vector<Vertex> vertices = {
-        // Position                 // Normal                // Texture
-        {vec3(-0.5f, -0.5f, -0.5f), vec3(0.0f, 0.0f, -1.0f), vec2(0.0f, 0.0f)},
-        {vec3( 0.5f, -0.5f, -0.5f), vec3(0.0f, 0.0f, -1.0f), vec2(1.0f, 0.0f)},
-        {vec3( 0.5f,  0.5f, -0.5f), vec3(0.0f, 0.0f, -1.0f), vec2(1.0f, 1.0f)},
-        {vec3( 0.5f,  0.5f, -0.5f), vec3(0.0f, 0.0f, -1.0f), vec2(1.0f, 1.0f)},
-        {vec3(-0.5f,  0.5f, -0.5f), vec3(0.0f, 0.0f, -1.0f), vec2(0.0f, 1.0f)},
-        {vec3(-0.5f, -0.5f, -0.5f), vec3(0.0f, 0.0f, -1.0f), vec2(0.0f, 0.0f)},
-
-        {vec3(-0.5f, -0.5f,  0.5f), vec3(0.0f, 0.0f, 1.0f), vec2(0.0f, 0.0f)},
-        {vec3( 0.5f, -0.5f,  0.5f), vec3(0.0f, 0.0f, 1.0f), vec2(1.0f, 0.0f)},
-        {vec3( 0.5f,  0.5f,  0.5f), vec3(0.0f, 0.0f, 1.0f), vec2(1.0f, 1.0f)},
-        {vec3( 0.5f,  0.5f,  0.5f), vec3(0.0f, 0.0f, 1.0f), vec2(1.0f, 1.0f)},
-        {vec3(-0.5f,  0.5f,  0.5f), vec3(0.0f, 0.0f, 1.0f), vec2(0.0f, 1.0f)},
-        {vec3(-0.5f, -0.5f,  0.5f), vec3(0.0f, 0.0f, 1.0f), vec2(0.0f, 0.0f)},
-
-        {vec3(-0.5f,  0.5f,  0.5f), vec3(-1.0f, 0.0f, 0.0f), vec2(1.0f, 0.0f)},
-        {vec3(-0.5f,  0.5f, -0.5f), vec3(-1.0f, 0.0f, 0.0f), vec2(1.0f, 1.0f)},
-        {vec3(-0.5f, -0.5f, -0.5f), vec3(-1.0f, 0.0f, 0.0f), vec2(0.0f, 1.0f)},
-        {vec3(-0.5f, -0.5f, -0.5f), vec3(-1.0f, 0.0f, 0.0f), vec2(0.0f, 1.0f)},
-        {vec3(-0.5f, -0.5f,  0.5f), vec3(-1.0f, 0.0f, 0.0f), vec2(0.0f, 0.0f)},
-        {vec3(-0.5f,  0.5f,  0.5f), vec3(-1.0f, 0.0f, 0.0f), vec2(1.0f, 0.0f)},
-
-        {vec3( 0.5f,  0.5f,  0.5f), vec3(1.0f, 0.0f, 0.0f), vec2(1.0f, 0.0f)},
-        {vec3( 0.5f,  0.5f, -0.5f), vec3(1.0f, 0.0f, 0.0f), vec2(1.0f, 1.0f)},
-        {vec3( 0.5f, -0.5f, -0.5f), vec3(1.0f, 0.0f, 0.0f), vec2(0.0f, 1.0f)},
-        {vec3( 0.5f, -0.5f, -0.5f), vec3(1.0f, 0.0f, 0.0f), vec2(0.0f, 1.0f)},
-        {vec3( 0.5f, -0.5f,  0.5f), vec3(1.0f, 0.0f, 0.0f), vec2(0.0f, 0.0f)},
-        {vec3( 0.5f,  0.5f,  0.5f), vec3(1.0f, 0.0f, 0.0f), vec2(1.0f, 0.0f)},
-
-        {vec3(-0.5f, -0.5f, -0.5f), vec3(0.0f, -1.0f, 0.0f), vec2(0.0f, 1.0f)},
-        {vec3( 0.5f, -0.5f, -0.5f), vec3(0.0f, -1.0f, 0.0f), vec2(1.0f, 1.0f)},
-        {vec3( 0.5f, -0.5f,  0.5f), vec3(0.0f, -1.0f, 0.0f), vec2(1.0f, 0.0f)},
-        {vec3( 0.5f, -0.5f,  0.5f), vec3(0.0f, -1.0f, 0.0f), vec2(1.0f, 0.0f)},
-        {vec3(-0.5f, -0.5f,  0.5f), vec3(0.0f, -1.0f, 0.0f), vec2(0.0f, 0.0f)},
-        {vec3(-0.5f, -0.5f, -0.5f), vec3(0.0f, -1.0f, 0.0f), vec2(0.0f, 1.0f)},
-
-        {vec3(-0.5f,  0.5f, -0.5f), vec3(0.0f, 1.0f, 0.0f), vec2(0.0f, 1.0f)},
-        {vec3( 0.5f,  0.5f, -0.5f), vec3(0.0f, 1.0f, 0.0f), vec2(1.0f, 1.0f)},
-        {vec3( 0.5f,  0.5f,  0.5f), vec3(0.0f, 1.0f, 0.0f), vec2(1.0f, 0.0f)},
-        {vec3( 0.5f,  0.5f,  0.5f), vec3(0.0f, 1.0f, 0.0f), vec2(1.0f, 0.0f)},
-        {vec3(-0.5f,  0.5f,  0.5f), vec3(0.0f, 1.0f, 0.0f), vec2(0.0f, 0.0f)},
-        {vec3(-0.5f,  0.5f, -0.5f), vec3(0.0f, 1.0f, 0.0f), vec2(0.0f, 1.0f)}
-    };
-
-    return Mesh(vertices);
+    return meshFromTables(CUBE_VERTICES_WITHOUT_INDICES);
 }
 
+Mesh createCube()
+{
+    return meshFromTables(CUBE_VERTICES, CUBE_INDICES);
+}
 
 Mesh createQuad()
 {
-    vector<Vertex> vertices = {
-        {vec3(-1.0f,  1.0f, 0.0f), vec3(0.0f), vec2(0.0f, 1.0f)},
-        {vec3(-1.0f, -1.0f, 0.0f), vec3(0.0f), vec2(0.0f, 0.0f)},
-        {vec3( 1.0f, -1.0f, 0.0f), vec3(0.0f), vec2(1.0f, 0.0f)},
-        {vec3( 1.0f,  1.0f, 0.0f), vec3(0.0f), vec2(1.0f, 1.0f)}
-    };
-
-    vector<unsigned int> indices = {
-        0, 1, 2,
-        2, 3, 0
-    };
-
-    return Mesh(vertices, indices);
+    return meshFromTables(QUAD_VERTICES, QUAD_INDICES);
 }
 
 Mesh createSquare()
 {
-    vector<Vertex> vertices = {
-        {vec3(-0.5f, 0.0f, 0.5f),  vec3(0.0f, 1.0f, 0.0f), vec2(0.0f, 0.0f)},
-        {vec3(0.5f, 0.0f, 0.5f),   vec3(0.0f, 1.0f, 0.0f), vec2(1.0f, 0.0f)},
-        {vec3(0.5f, 0.0f, -0.5f),  vec3(0.0f, 1.0f, 0.0f), vec2(1.0f, 1.0f)},
-        {vec3(-0.5f, 0.0f, -0.5f), vec3(0.0f, 1.0f, 0.0f), vec2(0.0f, 1.0f)}
-    };
-
-    vector<unsigned int> indices = {
-        1, 2, 0,
-        2, 3, 0
-    };
-
-    return Mesh(vertices, indices);
+    return meshFromTables(SQUARE_VERTICES, SQUARE_INDICES);
 }
 
 Mesh createIcosahedron()
 {
-    // Spherical coords with Y as up vector:
-    // x = cos(phi)sin(theta)
-    // y = sin(phi)
-    // z = cos(phi)cos(theta)
-
-    // Elevation from xz plane in degrees.
-    // phi = arctan(0.5);
-    const float phi = atanf(0.5f);
-    const float d_theta = 2*PI/5;
-
-    // Add top vertice.
-    vector<Vertex> vertices;
-    vertices.emplace_back(vec3(0.0f, 1.0f, 0.0f), vec3(0.0f, 1.0f, 0.0f));
-
-    // Add the 5 vertices below the first one.
-    for (float theta = 0.0f; theta < 2*PI - 0.01f; theta += d_theta) {
-        vec3 r{cosf(phi)*sinf(theta),
-               sinf(phi),
-               cosf(phi)*cosf(theta)};
-        vertices.emplace_back(r, r);
-    }
-
-    // Add the next 5 vertices.
-    for (float theta = 0.0f; theta < 2*PI - 0.01f; theta += d_theta) {
-        vec3 r{cosf(-phi)*sinf(theta + d_theta/2),
-               sinf(-phi),
-               cosf(-phi)*cosf(theta + d_theta/2)};
-        vertices.emplace_back(r, r);
-    }
-
-    // Add last vertice.
-    vertices.emplace_back(vec3(0.0f, -1.0f, 0.0f), vec3(0.0f, -1.0f, 0.0f));
-
-    // Define triangles.
-    vector<unsigned int> indices = {
-        // Top part.
-        0,1,2,  0,2,3,  0,3,4,  0,4,5,  0,5,1,
-        // Middle part.
-        1,6,2,  2,6,7,  2,7,3,  3,7,8,  3,8,4,  4,8,9,  4,9,5,  5,9,10,  5,10,1,  1,10,6,
-        // Bottom part.
-        11,7,6,  11,8,7,  11,9,8,  11,10,9,  11,6,10
-    };
-
-    return Mesh(vertices, indices);
+    return meshFromTables(ICOSPHERE_0.vertices, ICOSPHERE_0.indices);
 }
 
 
-Mesh createSphere(int n_latitude, int n_longitude)
+Mesh createSphere(int n_latitude, int n_longitude, MeshStorage storage)
 {
     // Spherical coords with Y as up vector:
     // x = cos(phi)sin(theta)
@@ -329,123 +329,302 @@ Mesh createSphere(int n_latitude, int n_longitude)
     const float phi_step  = (phi_end - phi_start) / (n_latitude - 1);
     const float theta_step = 2 * PI / (n_longitude - 1);
 
-    vector<Vertex> vertices;
     // TODO: add north and south pole vertices.
     //vertices.emplace_back(vec3(0.0f, 1.0f, 0.0f), vec3(0.0f, 1.0f, 0.0f), vec2(0.5f, 1.0f));
     //vertices.emplace_back(vec3(0.0f, -1.0f, 0.0f), vec3(0.0f, -1.0f, 0.0f));
 
-    float phi = phi_start;
-    for (int i = 0; i < n_latitude; ++i) {
-        float theta = 0.0f;
-        float v = static_cast<float>(i) / (n_latitude - 1);
-        for (int j = 0; j < n_longitude; ++j) {
-            vec3 r{cosf(phi) * sinf(theta), sinf(phi), cosf(phi) * cosf(theta)};
-            float u = static_cast<float>(j) / (n_longitude - 1);
-            vertices.emplace_back(r, r, vec2{u, v});
-
-            theta += theta_step;
+    const TrigTable phi_table(phi_start, phi_step, n_latitude);
+    const TrigTable theta_table(0.0f, theta_step, n_longitude);
+
+    return createParametricSurface(n_latitude, n_longitude, [&](int row_begin, int row_end, Vertex* out) {
+        for (int i = row_begin; i < row_end; ++i) {
+            const float v = static_cast<float>(i) / (n_latitude - 1);
+            const float cos_phi = phi_table.cos[i];
+            const float sin_phi = phi_table.sin[i];
+            for (int j = 0; j < n_longitude; ++j) {
+                const vec3 r{cos_phi * theta_table.sin[j], sin_phi, cos_phi * theta_table.cos[j]};
+                const float u = static_cast<float>(j) / (n_longitude - 1);
+                *out++ = Vertex(r, r, vec2{u, v});
+            }
         }
-        phi += phi_step;
-    }
-
-    // Define triangles.
-    vector<unsigned int> indices;
-    triangulatePatch(indices, n_latitude, n_longitude, false, false, 0);
-
-    return Mesh(vertices, indices);
+    }, storage);
 }
 
 
 Mesh createSubdividedIcosahedron(int order)
 {
     assert(order >= 0);
-    Mesh ico_mesh = createIcosahedron();
-    for (int i = 0; i < order; ++i)
+    switch (order) {
+    case 0: return meshFromTables(ICOSPHERE_0.vertices, ICOSPHERE_0.indices);
+    case 1: return meshFromTables(ICOSPHERE_1.vertices, ICOSPHERE_1.indices);
+    case 2: return meshFromTables(ICOSPHERE_2.vertices, ICOSPHERE_2.indices);
+    default: break;
+    }
+
+    Mesh ico_mesh = meshFromTables(ICOSPHERE_3.vertices, ICOSPHERE_3.indices);
+    for (int i = MAX_TABLE_ICOSPHERE_ORDER; i < order; ++i)
         subdivide(ico_mesh);
 
     return ico_mesh;
 }
 
 
-Mesh createTorus(float radius_a, float radius_b)
+Mesh createTorus(float radius_a,
+                 float radius_b,
+                 int num_samples_u,
+                 int num_samples_v,
+                 MeshStorage storage)
 {
     assert(radius_a >= 0.0f);
     assert(radius_b >= 0.0f);
+    assert(num_samples_u > 1);
+    assert(num_samples_v > 1);
 
-    const int num_samples_u = 30;
-    const int num_samples_v = 20;
     const float step_u = 1.0f / (num_samples_u - 1);
     const float step_v = 1.0f / (num_samples_v - 1);
+    const TrigTable theta_table(0.0f, step_u * 2 * PI, num_samples_u);
+    const TrigTable phi_table(0.0f, step_v * 2 * PI, num_samples_v);
 
-    vector<Vertex> vertices;
-    for (int j = 0; j < num_samples_v; ++j) {
-        for (int i = 0; i < num_samples_u; ++i) {
-            const float u = i * step_u;
+    return createParametricSurface(num_samples_v, num_samples_u, [&](int row_begin, int row_end, Vertex* out) {
+        for (int j = row_begin; j < row_end; ++j) {
             const float v = j * step_v;
-            const float theta = u * 2 * PI;
-            const float phi   = v * 2 * PI;
-            const float cos_theta = cosf(theta);
-            const float sin_theta = sin(theta);
-            const float cos_phi   = cosf(phi);
-            const float sin_phi   = sinf(phi);
-
-            // Compute torus position.
-            const float pos_x = (radius_a + radius_b * cos_phi) * sin_theta;
-            const float pos_y = radius_b * sin_phi;
-            const float pos_z = (radius_a + radius_b * cos_phi) * cos_theta;
-
-            // Compute normal vector.
-            const float n_x = cos_phi * sin_theta;
-            const float n_y = sin_phi;
-            const float n_z = cos_phi * cos_theta;
-
-            vertices.emplace_back(vec3{pos_x, pos_y, pos_z}, vec3{n_x, n_y, n_z}, vec2{u, v});
+            const float cos_phi = phi_table.cos[j];
+            const float sin_phi = phi_table.sin[j];
+            for (int i = 0; i < num_samples_u; ++i) {
+                const float u = i * step_u;
+                const float cos_theta = theta_table.cos[i];
+                const float sin_theta = theta_table.sin[i];
+
+                // Compute torus position.
+                const float pos_x = (radius_a + radius_b * cos_phi) * sin_theta;
+                const float pos_y = radius_b * sin_phi;
+                const float pos_z = (radius_a + radius_b * cos_phi) * cos_theta;
+
+                // Compute normal vector.
+                const float n_x = cos_phi * sin_theta;
+                const float n_y = sin_phi;
+                const float n_z = cos_phi * cos_theta;
+
+                *out++ = Vertex(vec3{pos_x, pos_y, pos_z}, vec3{n_x, n_y, n_z}, vec2{u, v});
+            }
         }
-    }
-
-    vector<unsigned int> indices;
-    triangulatePatch(indices, num_samples_v, num_samples_u, false, false);
-
-    return Mesh(vertices, indices);
+    }, storage);
 }
 
 
 Mesh createBezierPatch(const vector<vec3>& control_points,
                        int rows,
                        int cols,
-                       float sample_density)
+                       float sample_density,
+                       MeshStorage storage)
 {
     assert(rows >= 0);
     assert(cols >= 0);
     assert(sample_density >= 0.0f);
     assert(control_points.size() == rows * cols);
 
-    Mesh mesh;
-
     // Compute row and col of resulting mesh.
     const auto row_samples = static_cast<int>(rows * sample_density);
     const auto col_samples = static_cast<int>(cols * sample_density);
-    const float row_step = 1.0f / (row_samples - 1);
-    const float col_step = 1.0f / (col_samples - 1);
+
+    return createBezierPatch(control_points,
+                             BernsteinTable(rows - 1, row_samples),
+                             BernsteinTable(cols - 1, col_samples),
+                             storage);
+}
+
+Mesh createBezierPatch(const vector<vec3>& control_points,
+                       const BernsteinTable& row_table,
+                       const BernsteinTable& col_table,
+                       MeshStorage storage)
+{
+    return createParametricSurface(row_table.n_samples, col_table.n_samples, [&](int row_begin, int row_end, Vertex* out) {
+        sampleBezierPatch(control_points, row_table, col_table, row_begin, row_end, out);
+    }, storage);
+}
+
+void sampleBezierPatch(const vector<vec3>& control_points,
+                       const BernsteinTable& row_table,
+                       const BernsteinTable& col_table,
+                       int row_begin,
+                       int row_end,
+                       Vertex* out)
+{
+    const int col_samples = col_table.n_samples;
 
     // Sample from Bezier surface.
-    float u = 0.0f;
-    float v = 0.0f;
-    for (int i = 0; i < row_samples; ++i) {
+    const size_t n_samples = static_cast<size_t>(row_end - row_begin) * col_samples;
+    vector<vec3> positions(n_samples);
+    vector<vec3> normals(n_samples);
+    evaluateBezierSurface(control_points, row_table, col_table, row_begin, row_end,
+                          positions.data(), normals.data());
+
+    for (int i = row_begin; i < row_end; ++i) {
         for (int j = 0; j < col_samples; ++j) {
-            const auto sample = bezierSurfaceSample(control_points, rows, cols, u, v);
-            const vec3 position = get<0>(sample);
-            const vec3 normal = get<1>(sample);
-            mesh.vertices.emplace_back(position, normal, vec2(u, v));
+            const size_t sample = static_cast<size_t>(i - row_begin) * col_samples + j;
+
+            // Degenerate samples, e.g. where a patch edge collapses to a pole, have no normal.
+            // Take the one slightly inside the patch, where the tangents don't vanish.
+            if (glm::dot(normals[sample], normals[sample]) == 0.0f) {
+                const float u = clamp(row_table.params[i], EDGE_OFFSET, 1.0f - EDGE_OFFSET);
+                const float v = clamp(col_table.params[j], EDGE_OFFSET, 1.0f - EDGE_OFFSET);
+                const vec3 inner_normal = get<1>(bezierSurfaceSample(control_points,
+                                                                     row_table.degree + 1,
+                                                                     col_table.degree + 1,
+                                                                     u, v));
+                if (isfinite(inner_normal.x) && isfinite(inner_normal.y) && isfinite(inner_normal.z))
+                    normals[sample] = inner_normal;
+            }
+            *out++ = Vertex(positions[sample],
+                            normals[sample],
+                            vec2(row_table.params[i], col_table.params[j]));
+        }
+    }
+}
+
 
-            v += col_step;
+// Largest second difference along a control polygon of `count` points, `stride` apart.
+static float maxSecondDifference(const vec3* points, int count, int stride)
+{
+    float max_length = 0.0f;
+    for (int k = 0; k + 2 < count; ++k) {
+        const vec3 d = points[k*stride] - 2.0f * points[(k + 1)*stride] + points[(k + 2)*stride];
+        max_length = max(max_length, glm::length(d));
+    }
+    return max_length;
+}
+
+// Segments needed for the polyline through evenly spaced samples of a Bezier curve of the given
+// degree to stay within `max_error` of it, given its largest control polygon second difference:
+// the error is at most degree * (degree - 1) / 8 * second_difference / segments^2.
+static int segmentsForError(int degree, float second_difference, float max_error)
+{
+    const float bound = degree * (degree - 1) / 8.0f * second_difference;
+    return max(1, static_cast<int>(ceil(sqrt(bound / max_error))));
+}
+
+// Minimal union-find over sample count classes.
+class DisjointSets
+{
+public:
+
+    explicit DisjointSets(size_t count):
+        parent_(count)
+    {
+        for (size_t i = 0; i < count; ++i)
+            parent_[i] = i;
+    }
+
+    size_t find(size_t i)
+    {
+        while (parent_[i] != i) {
+            parent_[i] = parent_[parent_[i]];
+            i = parent_[i];
+        }
+        return i;
+    }
+
+    void merge(size_t a, size_t b)
+    {
+        parent_[find(a)] = find(b);
+    }
+
+private:
+
+    vector<size_t> parent_;
+};
+
+Mesh createAdaptiveBezierPatches(const vector<vec3>& control_points,
+                                 const vector<unsigned int>& patch_indices,
+                                 int rows,
+                                 int cols,
+                                 float max_error)
+{
+    assert(rows >= 2);
+    assert(cols >= 2);
+    assert(max_error > 0.0f);
+    const size_t patch_size = static_cast<size_t>(rows) * cols;
+    assert(patch_indices.size() % patch_size == 0);
+    const size_t n_patches = patch_indices.size() / patch_size;
+
+    // Control points may be duplicated in the data, so boundaries are compared by position.
+    vector<unsigned int> unique_index(control_points.size());
+    {
+        map<array<float, 3>, unsigned int> index_of_position;
+        for (size_t i = 0; i < control_points.size(); ++i) {
+            const vec3& p = control_points[i];
+            unique_index[i] = index_of_position.emplace(array<float, 3>{p.x, p.y, p.z},
+                                                        static_cast<unsigned int>(i)).first->second;
         }
-        u += row_step;
-        v = 0.0f;
     }
 
-    // Triangulate the sampled patch.
-    triangulatePatch(mesh.indices, row_samples, col_samples);
+    // Patch p has two sample counts: class 2p for rows (along u), class 2p + 1 for columns
+    // (along v). Its first and last rows of control points are boundary curves sampled with the
+    // column count, its first and last columns are sampled with the row count.
+    vector<int> segments(2 * n_patches);
+    DisjointSets classes(2 * n_patches);
+    map<vector<unsigned int>, size_t> class_of_curve;
+
+    auto linkBoundary = [&](const unsigned int* patch, int first, int count, int stride, size_t sample_class) {
+        vector<unsigned int> curve(count);
+        for (int k = 0; k < count; ++k)
+            curve[k] = unique_index[patch[first + k*stride]];
+        // A curve collapsed to a point (a pole) cannot open a crack.
+        if (all_of(curve.begin(), curve.end(), [&](unsigned int i) { return i == curve[0]; }))
+            return;
+        // Neighbours may run along a shared curve in opposite directions.
+        if (curve.back() < curve.front())
+            reverse(curve.begin(), curve.end());
+
+        const auto inserted = class_of_curve.emplace(curve, sample_class);
+        if (!inserted.second)
+            classes.merge(inserted.first->second, sample_class);
+    };
+
+    for (size_t p = 0; p < n_patches; ++p) {
+        const unsigned int* patch = &patch_indices[p * patch_size];
+        vector<vec3> points(patch_size);
+        for (size_t k = 0; k < patch_size; ++k)
+            points[k] = control_points[patch[k]];
+
+        // Flatness of the control grid along each direction.
+        float u_difference = 0.0f;
+        for (int j = 0; j < cols; ++j)
+            u_difference = max(u_difference, maxSecondDifference(&points[j], rows, cols));
+        float v_difference = 0.0f;
+        for (int i = 0; i < rows; ++i)
+            v_difference = max(v_difference, maxSecondDifference(&points[i*cols], cols, 1));
+
+        // Errors along both directions add up, so each gets half of the budget.
+        segments[2*p] = segmentsForError(rows - 1, u_difference, 0.5f * max_error);
+        segments[2*p + 1] = segmentsForError(cols - 1, v_difference, 0.5f * max_error);
+
+        linkBoundary(patch, 0, cols, 1, 2*p + 1);
+        linkBoundary(patch, (rows - 1) * cols, cols, 1, 2*p + 1);
+        linkBoundary(patch, 0, rows, cols, 2*p);
+        linkBoundary(patch, cols - 1, rows, cols, 2*p);
+    }
+
+    // Every class is sampled as finely as its most curved member needs.
+    vector<int> class_segments(2 * n_patches, 0);
+    for (size_t c = 0; c < 2 * n_patches; ++c)
+        class_segments[classes.find(c)] = max(class_segments[classes.find(c)], segments[c]);
+
+    // Patches sampled alike share their basis tables.
+    map<int, BernsteinTable> row_tables;
+    map<int, BernsteinTable> col_tables;
+    Mesh mesh;
+    vector<vec3> points(patch_size);
+    for (size_t p = 0; p < n_patches; ++p) {
+        const int row_samples = class_segments[classes.find(2*p)] + 1;
+        const int col_samples = class_segments[classes.find(2*p + 1)] + 1;
+        const auto& row_table = row_tables.try_emplace(row_samples, rows - 1, row_samples).first->second;
+        const auto& col_table = col_tables.try_emplace(col_samples, cols - 1, col_samples).first->second;
+
+        for (size_t k = 0; k < patch_size; ++k)
+            points[k] = control_points[patch_indices[p * patch_size + k]];
+        mesh.extend(createBezierPatch(points, row_table, col_table));
+    }
 
     return mesh;
 }
@@ -1,14 +1,103 @@
 #ifndef GEOMETRY_HPP
 #define GEOMETRY_HPP
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <vector>
 
 #include <glm/vec3.hpp>
 
+#include "Math.hpp"
 #include "Mesh.hpp"
+#include "Parallel.hpp"
 
 void subdivide(Mesh& mesh, bool project_onto_unit_sphere = true);
 
+// Append the triangles of a `rows` x `cols` grid of vertices, stored row by row from `first_index`.
+void triangulatePatch(std::vector<unsigned int>& indices,
+                      int rows,
+                      int cols,
+                      bool wrap_horizontally = false,
+                      bool wrap_vertically = false,
+                      unsigned int first_index = 0);
+
+// Number of indices triangulatePatch() appends for a grid without wrapping.
+inline size_t patchIndexCount(int rows, int cols)
+{
+    return rows > 1 && cols > 1 ? 6 * static_cast<size_t>(rows - 1) * (cols - 1) : 0;
+}
+
+// Write the same triangles as triangulatePatch() without wrapping, to an array of
+// patchIndexCount() indices. Returns the end of the written indices.
+template <typename Index>
+Index* writePatchIndices(Index* out, int rows, int cols, unsigned int first_index = 0)
+{
+    for (int i = 0; i < rows - 1; ++i) {
+        for (int j = 0; j < cols - 1; ++j) {
+            const auto current     = static_cast<Index>(first_index + i*cols + j);
+            const auto right       = static_cast<Index>(current + 1);
+            const auto below       = static_cast<Index>(current + cols);
+            const auto right_below = static_cast<Index>(current + cols + 1);
+
+            *out++ = below;
+            *out++ = right_below;
+            *out++ = current;
+            *out++ = right_below;
+            *out++ = right;
+            *out++ = current;
+        }
+    }
+    return out;
+}
+
+// Build the mesh of a parametric surface sampled on a `rows` x `cols` grid, triangulated with
+// triangulatePatch().
+// `surface(row_begin, row_end, out)` must write the vertices of rows [row_begin, row_end) to `out`,
+// row by row. The vertex array is allocated once and filled in parallel bands of rows: in CPU
+// memory, or straight in the mapped vertex buffer with MeshStorage::GPU.
+template <typename Surface>
+Mesh createParametricSurface(int rows, int cols, Surface&& surface, MeshStorage storage = MeshStorage::CPU)
+{
+    // Below this amount of vertices, the surface is sampled on the calling thread.
+    constexpr size_t MIN_VERTICES_PER_TASK = 16384;
+
+    const size_t n_vertices = static_cast<size_t>(rows) * cols;
+    const size_t min_rows_per_task = std::max<size_t>(1, MIN_VERTICES_PER_TASK / std::max(cols, 1));
+    auto sampleRows = [&](Vertex* vertices) {
+        parallelFor(0, rows, min_rows_per_task, [&](size_t row_begin, size_t row_end) {
+            surface(static_cast<int>(row_begin), static_cast<int>(row_end), &vertices[row_begin * cols]);
+        });
+    };
+
+    Mesh mesh;
+    if (storage == MeshStorage::GPU) {
+        MappedMeshBuffers buffers;
+        do {
+            buffers = mesh.mapGpuBuffers(n_vertices, patchIndexCount(rows, cols));
+            if (buffers.vertices == nullptr)
+                break;
+            sampleRows(buffers.vertices);
+            if (buffers.short_indices)
+                writePatchIndices(static_cast<uint16_t*>(buffers.indices), rows, cols);
+            else
+                writePatchIndices(static_cast<unsigned int*>(buffers.indices), rows, cols);
+        } while (!mesh.unmapGpuBuffers());
+        if (buffers.vertices != nullptr)
+            return mesh;
+        // The buffers could not be mapped: go through CPU memory instead.
+    }
+
+    mesh.vertices.resize(n_vertices);
+    sampleRows(mesh.vertices.data());
+    triangulatePatch(mesh.indices, rows, cols);
+    if (storage != MeshStorage::CPU)
+        mesh.pushToGpu();
+    if (storage == MeshStorage::GPU)
+        mesh.releaseCpu();
+    return mesh;
+}
+
 Mesh createCubeWithoutIndices();
 
 Mesh createCube();
@@ -19,16 +108,48 @@ Mesh createSquare();
 
 Mesh createIcosahedron();
 
-Mesh createSphere(int n_latitude, int n_longitude);
+Mesh createSphere(int n_latitude, int n_longitude, MeshStorage storage = MeshStorage::CPU);
 
 Mesh createSubdividedIcosahedron(int order);
 
-Mesh createTorus(float radius_a, float radius_b);
+Mesh createTorus(float radius_a,
+                 float radius_b,
+                 int num_samples_u = 30,
+                 int num_samples_v = 20,
+                 MeshStorage storage = MeshStorage::CPU);
 
 Mesh createBezierPatch(const std::vector<glm::vec3>& control_points,
                        int rows,
                        int cols,
-                       float sample_density = 1.0f);
+                       float sample_density = 1.0f,
+                       MeshStorage storage = MeshStorage::CPU);
+
+// Same as above, with the sampling grid given by the basis tables of the rows and columns, so
+// patches sampled alike share them.
+Mesh createBezierPatch(const std::vector<glm::vec3>& control_points,
+                       const BernsteinTable& row_table,
+                       const BernsteinTable& col_table,
+                       MeshStorage storage = MeshStorage::CPU);
+
+// Write the vertices of rows [row_begin, row_end) of a Bezier patch sampled on the grid of the
+// basis tables to `out`, row by row. Degenerate samples take the normal of a point slightly
+// inside the patch, as BezierPatch.tese does, so every normal is defined.
+void sampleBezierPatch(const std::vector<glm::vec3>& control_points,
+                       const BernsteinTable& row_table,
+                       const BernsteinTable& col_table,
+                       int row_begin,
+                       int row_end,
+                       Vertex* out);
+
+// Sample Bezier patches of `rows` x `cols` control points, listed by `patch_indices` into
+// `control_points`. Each patch gets just enough samples along each direction for its triangulation
+// to stay within `max_error` of the surface, estimated from the flatness of its control grid.
+// Patches sharing a boundary curve sample it with the same count, so no crack opens between them.
+Mesh createAdaptiveBezierPatches(const std::vector<glm::vec3>& control_points,
+                                 const std::vector<unsigned int>& patch_indices,
+                                 int rows,
+                                 int cols,
+                                 float max_error);
 
 
 #endif  // GEOMETRY_HPP
@@ -0,0 +1,199 @@
+#include "GeometryArena.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+#include <glad/glad.h>
+
+#include "GlState.hpp"
+
+using namespace std;
+
+// Largest vertex count addressable by 16-bit indices.
+static const size_t MAX_SHORT_INDEXED_VERTICES = 65536;
+
+GeometryArena::GeometryArena():
+    vao_{0}, vbo_{0}, ebo_{0},
+    position_vbo_{0}, depth_vao_{0},
+    format_(VertexFormat::FLOAT32),
+    index_type_(GL_UNSIGNED_INT),
+    max_mesh_vertices_(0)
+{
+}
+
+GeometryArena::~GeometryArena()
+{
+    if (vao_ != 0)
+        GlState::deleteVertexArray(vao_);
+    if (depth_vao_ != 0)
+        GlState::deleteVertexArray(depth_vao_);
+
+    const unsigned int buffers[] = {vbo_, ebo_, position_vbo_};
+    for (const unsigned int buffer : buffers) {
+        if (buffer != 0)
+            glDeleteBuffers(1, &buffer);
+    }
+}
+
+bool GeometryArena::isMultiDrawSupported()
+{
+    return GLAD_GL_VERSION_4_3 != 0;
+}
+
+void GeometryArena::add(const Mesh& mesh)
+{
+    assert(ranges_.find(&mesh) == ranges_.end());
+    assert(!mesh.vertices.empty());
+    assert(ranges_.empty() || mesh.vertexFormat() == format_);
+
+    format_ = mesh.vertexFormat();
+
+    MeshRange range;
+    range.first_index = static_cast<unsigned int>(indices_.size());
+    if (format_ == VertexFormat::PACKED) {
+        range.base_vertex = static_cast<int>(packed_vertices_.size());
+        const auto packed = packVertices(mesh.vertices, mesh.dequantization());
+        packed_vertices_.insert(packed_vertices_.end(), packed.begin(), packed.end());
+        const auto packed_positions = packPositions(mesh.vertices, mesh.dequantization());
+        packed_positions_.insert(packed_positions_.end(), packed_positions.begin(), packed_positions.end());
+    }
+    else {
+        range.base_vertex = static_cast<int>(vertices_.size());
+        vertices_.insert(vertices_.end(), mesh.vertices.begin(), mesh.vertices.end());
+        for (const auto& v : mesh.vertices)
+            positions_.push_back(v.pos);
+    }
+    max_mesh_vertices_ = max(max_mesh_vertices_, mesh.vertices.size());
+
+    if (mesh.indices.empty()) {
+        for (unsigned int i = 0; i < mesh.vertices.size(); ++i)
+            indices_.push_back(i);
+    }
+    else {
+        indices_.insert(indices_.end(), mesh.indices.begin(), mesh.indices.end());
+    }
+    range.index_count = static_cast<unsigned int>(indices_.size()) - range.first_index;
+
+    ranges_.emplace(&mesh, range);
+}
+
+void GeometryArena::pushToGpu(bool with_position_stream)
+{
+    assert(!indices_.empty());
+    assert(vao_ == 0);
+
+    // Create OpenGL objects on upload, so an unused arena owns none.
+    glGenVertexArrays(1, &vao_);
+    glGenBuffers(1, &vbo_);
+    glGenBuffers(1, &ebo_);
+
+    GlState::bindVertexArray(vao_);
+
+    // Populate Vertex Buffer Object with the vertex data of all meshes.
+    glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+    if (format_ == VertexFormat::PACKED) {
+        glBufferData(GL_ARRAY_BUFFER,
+                     packed_vertices_.size() * sizeof(PackedVertex),
+                     packed_vertices_.data(),
+                     GL_STATIC_DRAW);
+    }
+    else {
+        glBufferData(GL_ARRAY_BUFFER,
+                     vertices_.size() * sizeof(Vertex),
+                     vertices_.data(),
+                     GL_STATIC_DRAW);
+    }
+    Mesh::setVertexAttributes(format_);
+
+    // Indices are relative to the base vertex of their mesh, so 16 bits are enough as long as
+    // every mesh is small enough.
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_);
+    if (max_mesh_vertices_ <= MAX_SHORT_INDEXED_VERTICES) {
+        index_type_ = GL_UNSIGNED_SHORT;
+        const vector<uint16_t> short_indices(indices_.begin(), indices_.end());
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                     short_indices.size() * sizeof(uint16_t),
+                     short_indices.data(),
+                     GL_STATIC_DRAW);
+    }
+    else {
+        index_type_ = GL_UNSIGNED_INT;
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                     indices_.size() * sizeof(unsigned int),
+                     indices_.data(),
+                     GL_STATIC_DRAW);
+    }
+
+    if (with_position_stream) {
+        glGenVertexArrays(1, &depth_vao_);
+        glGenBuffers(1, &position_vbo_);
+
+        GlState::bindVertexArray(depth_vao_);
+        glBindBuffer(GL_ARRAY_BUFFER, position_vbo_);
+        if (format_ == VertexFormat::PACKED) {
+            glBufferData(GL_ARRAY_BUFFER,
+                         packed_positions_.size() * sizeof(PackedPosition),
+                         packed_positions_.data(),
+                         GL_STATIC_DRAW);
+        }
+        else {
+            glBufferData(GL_ARRAY_BUFFER,
+                         positions_.size() * sizeof(glm::vec3),
+                         positions_.data(),
+                         GL_STATIC_DRAW);
+        }
+        Mesh::setPositionAttribute(format_);
+
+        // Both VAOs share the element buffer.
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_);
+    }
+
+    // Unbind.
+    GlState::bindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    // The GPU copy is the only one needed from now on.
+    vector<Vertex>().swap(vertices_);
+    vector<PackedVertex>().swap(packed_vertices_);
+    vector<glm::vec3>().swap(positions_);
+    vector<PackedPosition>().swap(packed_positions_);
+    vector<unsigned int>().swap(indices_);
+}
+
+bool GeometryArena::isEmpty() const
+{
+    return ranges_.empty();
+}
+
+const MeshRange* GeometryArena::find(const Mesh* mesh) const
+{
+    const auto it = ranges_.find(mesh);
+    return it != ranges_.end() ? &it->second : nullptr;
+}
+
+unsigned int GeometryArena::getId() const
+{
+    return vao_;
+}
+
+unsigned int GeometryArena::getDepthId() const
+{
+    return depth_vao_ != 0 ? depth_vao_ : vao_;
+}
+
+void GeometryArena::multiDraw(const DrawCommandBuffer& commands,
+                              size_t first,
+                              size_t count,
+                              bool depth_only) const
+{
+    assert(first + count <= commands.size());
+
+    GlState::bindVertexArray(depth_only ? getDepthId() : vao_);
+    commands.bind();
+    glMultiDrawElementsIndirect(GL_TRIANGLES,
+                               index_type_,
+                               (void*)(commands.offset() + first * sizeof(DrawCommand)),
+                               static_cast<int>(count),
+                               0);
+}
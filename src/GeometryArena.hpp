@@ -0,0 +1,88 @@
+#ifndef GEOMETRY_ARENA_HPP
+#define GEOMETRY_ARENA_HPP
+
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+#include "DrawCommandBuffer.hpp"
+#include "Mesh.hpp"
+
+// Location of a mesh in the arena buffers.
+struct MeshRange
+{
+    unsigned int first_index;
+    unsigned int index_count;
+    int base_vertex;
+};
+
+// One vertex buffer and one index buffer shared by all static meshes, behind a single VAO.
+//
+// Meshes are suballocated from the arena, so draws of different meshes need no VAO switch, and
+// a whole list of draws can be submitted at once with glMultiDrawElementsIndirect, from commands
+// built on the CPU and stored in a DrawCommandBuffer. Multi-draw requires OpenGL 4.3; the arena
+// is left empty on older contexts and meshes are drawn through their own VAO instead.
+class GeometryArena
+{
+private:
+    // Handles to OpenGL objects, created by pushToGpu().
+    unsigned int vao_;
+    unsigned int vbo_;
+    unsigned int ebo_;
+    // Position stream and its VAO, for depth only draws. Only created on demand.
+    unsigned int position_vbo_;
+    unsigned int depth_vao_;
+
+    // Vertex format of all meshes, and type of the indices in the element buffer.
+    VertexFormat format_;
+    unsigned int index_type_;
+
+    // Geometry waiting to be pushed to the GPU, in the format of the meshes.
+    std::vector<Vertex> vertices_;
+    std::vector<PackedVertex> packed_vertices_;
+    std::vector<glm::vec3> positions_;
+    std::vector<PackedPosition> packed_positions_;
+    std::vector<unsigned int> indices_;
+    // Largest vertex count of a mesh. Indices are relative to the mesh base vertex.
+    size_t max_mesh_vertices_;
+
+    std::unordered_map<const Mesh*, MeshRange> ranges_;
+
+public:
+    GeometryArena();
+    ~GeometryArena();
+
+    GeometryArena(const GeometryArena&) = delete;
+    GeometryArena& operator=(const GeometryArena&) = delete;
+
+    // Whether the context can submit draws with glMultiDrawElementsIndirect.
+    static bool isMultiDrawSupported();
+
+    // Append a copy of a mesh, in its vertex format, which must be the same for all meshes.
+    // Packed meshes keep their dequantization. Meshes without indices get a trivial index list.
+    // The copy is made from the CPU arrays, which meshes generated with MeshStorage::GPU lack.
+    void add(const Mesh& mesh);
+    // Upload all added meshes. No mesh can be added afterwards.
+    // See MeshUploadOptions for `with_position_stream`.
+    void pushToGpu(bool with_position_stream = false);
+
+    // Whether meshes were pushed to the arena.
+    bool isEmpty() const;
+    // Range of a mesh, or nullptr if the mesh is not in the arena.
+    const MeshRange* find(const Mesh* mesh) const;
+    // Handle of the shared vertex array object.
+    unsigned int getId() const;
+    // Handle of the vertex array object used by depth only draws.
+    unsigned int getDepthId() const;
+
+    // Submit `count` commands of a command buffer, starting at `first`. Depth only draws read
+    // the position stream if there is one.
+    void multiDraw(const DrawCommandBuffer& commands,
+                   size_t first,
+                   size_t count,
+                   bool depth_only = false) const;
+};
+
+#endif // GEOMETRY_ARENA_HPP
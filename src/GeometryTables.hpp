@@ -0,0 +1,277 @@
+#ifndef GEOMETRY_TABLES_HPP
+#define GEOMETRY_TABLES_HPP
+
+#include <array>
+#include <cstddef>
+
+#include "Math.hpp"
+
+// Vertex and index tables of the basic shapes, computed at compile time.
+//
+// They live in read-only data: creating a mesh from them only copies the tables, and they can be
+// uploaded to a buffer as they are, since VertexData has the layout of a Vertex.
+
+// Vertex attributes usable in constant expressions, laid out like a Vertex.
+struct VertexData
+{
+    float pos[3];
+    float normal[3];
+    float tex[2];
+};
+
+
+// Cube of side 1 centered on the origin, as 12 independent triangles.
+inline constexpr std::array<VertexData, 36> CUBE_VERTICES_WITHOUT_INDICES = {{
+    // Position               // Normal             // Texture
+    {{-0.5f, -0.5f, -0.5f}, {0.0f, 0.0f, -1.0f}, {0.0f, 0.0f}},
+    {{ 0.5f, -0.5f, -0.5f}, {0.0f, 0.0f, -1.0f}, {1.0f, 0.0f}},
+    {{ 0.5f,  0.5f, -0.5f}, {0.0f, 0.0f, -1.0f}, {1.0f, 1.0f}},
+    {{ 0.5f,  0.5f, -0.5f}, {0.0f, 0.0f, -1.0f}, {1.0f, 1.0f}},
+    {{-0.5f,  0.5f, -0.5f}, {0.0f, 0.0f, -1.0f}, {0.0f, 1.0f}},
+    {{-0.5f, -0.5f, -0.5f}, {0.0f, 0.0f, -1.0f}, {0.0f, 0.0f}},
+
+    {{-0.5f, -0.5f,  0.5f}, {0.0f, 0.0f, 1.0f}, {0.0f, 0.0f}},
+    {{ 0.5f, -0.5f,  0.5f}, {0.0f, 0.0f, 1.0f}, {1.0f, 0.0f}},
+    {{ 0.5f,  0.5f,  0.5f}, {0.0f, 0.0f, 1.0f}, {1.0f, 1.0f}},
+    {{ 0.5f,  0.5f,  0.5f}, {0.0f, 0.0f, 1.0f}, {1.0f, 1.0f}},
+    {{-0.5f,  0.5f,  0.5f}, {0.0f, 0.0f, 1.0f}, {0.0f, 1.0f}},
+    {{-0.5f, -0.5f,  0.5f}, {0.0f, 0.0f, 1.0f}, {0.0f, 0.0f}},
+
+    {{-0.5f,  0.5f,  0.5f}, {-1.0f, 0.0f, 0.0f}, {1.0f, 0.0f}},
+    {{-0.5f,  0.5f, -0.5f}, {-1.0f, 0.0f, 0.0f}, {1.0f, 1.0f}},
+    {{-0.5f, -0.5f, -0.5f}, {-1.0f, 0.0f, 0.0f}, {0.0f, 1.0f}},
+    {{-0.5f, -0.5f, -0.5f}, {-1.0f, 0.0f, 0.0f}, {0.0f, 1.0f}},
+    {{-0.5f, -0.5f,  0.5f}, {-1.0f, 0.0f, 0.0f}, {0.0f, 0.0f}},
+    {{-0.5f,  0.5f,  0.5f}, {-1.0f, 0.0f, 0.0f}, {1.0f, 0.0f}},
+
+    {{ 0.5f,  0.5f,  0.5f}, {1.0f, 0.0f, 0.0f}, {1.0f, 0.0f}},
+    {{ 0.5f,  0.5f, -0.5f}, {1.0f, 0.0f, 0.0f}, {1.0f, 1.0f}},
+    {{ 0.5f, -0.5f, -0.5f}, {1.0f, 0.0f, 0.0f}, {0.0f, 1.0f}},
+    {{ 0.5f, -0.5f, -0.5f}, {1.0f, 0.0f, 0.0f}, {0.0f, 1.0f}},
+    {{ 0.5f, -0.5f,  0.5f}, {1.0f, 0.0f, 0.0f}, {0.0f, 0.0f}},
+    {{ 0.5f,  0.5f,  0.5f}, {1.0f, 0.0f, 0.0f}, {1.0f, 0.0f}},
+
+    {{-0.5f, -0.5f, -0.5f}, {0.0f, -1.0f, 0.0f}, {0.0f, 1.0f}},
+    {{ 0.5f, -0.5f, -0.5f}, {0.0f, -1.0f, 0.0f}, {1.0f, 1.0f}},
+    {{ 0.5f, -0.5f,  0.5f}, {0.0f, -1.0f, 0.0f}, {1.0f, 0.0f}},
+    {{ 0.5f, -0.5f,  0.5f}, {0.0f, -1.0f, 0.0f}, {1.0f, 0.0f}},
+    {{-0.5f, -0.5f,  0.5f}, {0.0f, -1.0f, 0.0f}, {0.0f, 0.0f}},
+    {{-0.5f, -0.5f, -0.5f}, {0.0f, -1.0f, 0.0f}, {0.0f, 1.0f}},
+
+    {{-0.5f,  0.5f, -0.5f}, {0.0f, 1.0f, 0.0f}, {0.0f, 1.0f}},
+    {{ 0.5f,  0.5f, -0.5f}, {0.0f, 1.0f, 0.0f}, {1.0f, 1.0f}},
+    {{ 0.5f,  0.5f,  0.5f}, {0.0f, 1.0f, 0.0f}, {1.0f, 0.0f}},
+    {{ 0.5f,  0.5f,  0.5f}, {0.0f, 1.0f, 0.0f}, {1.0f, 0.0f}},
+    {{-0.5f,  0.5f,  0.5f}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f}},
+    {{-0.5f,  0.5f, -0.5f}, {0.0f, 1.0f, 0.0f}, {0.0f, 1.0f}}
+}};
+
+// The same cube, indexed: each face keeps its 4 distinct corners. Faces above list their
+// triangles as (0, 1, 2) and (2, 4, 0).
+constexpr std::array<VertexData, 24> makeCubeVertices()
+{
+    std::array<VertexData, 24> vertices{};
+    for (size_t face = 0; face < 6; ++face) {
+        vertices[4*face + 0] = CUBE_VERTICES_WITHOUT_INDICES[6*face + 0];
+        vertices[4*face + 1] = CUBE_VERTICES_WITHOUT_INDICES[6*face + 1];
+        vertices[4*face + 2] = CUBE_VERTICES_WITHOUT_INDICES[6*face + 2];
+        vertices[4*face + 3] = CUBE_VERTICES_WITHOUT_INDICES[6*face + 4];
+    }
+    return vertices;
+}
+
+constexpr std::array<unsigned int, 36> makeCubeIndices()
+{
+    std::array<unsigned int, 36> indices{};
+    for (unsigned int face = 0; face < 6; ++face) {
+        const unsigned int corner[6] = {0, 1, 2, 2, 3, 0};
+        for (unsigned int i = 0; i < 6; ++i)
+            indices[6*face + i] = 4*face + corner[i];
+    }
+    return indices;
+}
+
+inline constexpr std::array<VertexData, 24> CUBE_VERTICES = makeCubeVertices();
+inline constexpr std::array<unsigned int, 36> CUBE_INDICES = makeCubeIndices();
+
+
+// Screen covering quad, in the XY plane.
+inline constexpr std::array<VertexData, 4> QUAD_VERTICES = {{
+    {{-1.0f,  1.0f, 0.0f}, {0.0f, 0.0f, 0.0f}, {0.0f, 1.0f}},
+    {{-1.0f, -1.0f, 0.0f}, {0.0f, 0.0f, 0.0f}, {0.0f, 0.0f}},
+    {{ 1.0f, -1.0f, 0.0f}, {0.0f, 0.0f, 0.0f}, {1.0f, 0.0f}},
+    {{ 1.0f,  1.0f, 0.0f}, {0.0f, 0.0f, 0.0f}, {1.0f, 1.0f}}
+}};
+
+inline constexpr std::array<unsigned int, 6> QUAD_INDICES = {
+    0, 1, 2,
+    2, 3, 0
+};
+
+
+// Square of side 1 in the XZ plane, facing up.
+inline constexpr std::array<VertexData, 4> SQUARE_VERTICES = {{
+    {{-0.5f, 0.0f,  0.5f}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f}},
+    {{ 0.5f, 0.0f,  0.5f}, {0.0f, 1.0f, 0.0f}, {1.0f, 0.0f}},
+    {{ 0.5f, 0.0f, -0.5f}, {0.0f, 1.0f, 0.0f}, {1.0f, 1.0f}},
+    {{-0.5f, 0.0f, -0.5f}, {0.0f, 1.0f, 0.0f}, {0.0f, 1.0f}}
+}};
+
+inline constexpr std::array<unsigned int, 6> SQUARE_INDICES = {
+    1, 2, 0,
+    2, 3, 0
+};
+
+
+// Highest order of the subdivided icosahedra built at compile time. Higher orders are subdivided
+// at runtime from this one.
+constexpr int MAX_TABLE_ICOSPHERE_ORDER = 3;
+
+// Icosahedron subdivided `ORDER` times, with vertices on the unit sphere.
+template <int ORDER>
+struct IcosphereTable
+{
+    static_assert(ORDER >= 0 && ORDER <= MAX_TABLE_ICOSPHERE_ORDER, "Icosphere order too high for a table");
+
+    static constexpr size_t N_TRIANGLES = size_t{20} << (2 * ORDER);
+    static constexpr size_t N_VERTICES = N_TRIANGLES / 2 + 2;
+
+    std::array<VertexData, N_VERTICES> vertices;
+    std::array<unsigned int, 3 * N_TRIANGLES> indices;
+};
+
+// Unit sphere vertex, its own normal.
+constexpr VertexData sphereVertexData(double x, double y, double z)
+{
+    const double inv_length = 1.0 / constexprSqrt(x*x + y*y + z*z);
+    const float p[3] = {static_cast<float>(x * inv_length),
+                        static_cast<float>(y * inv_length),
+                        static_cast<float>(z * inv_length)};
+    return VertexData{{p[0], p[1], p[2]}, {p[0], p[1], p[2]}, {0.0f, 0.0f}};
+}
+
+// Same vertices and triangles as subdivide() applied `ORDER` times to createIcosahedron().
+template <int ORDER>
+constexpr IcosphereTable<ORDER> makeIcosphereTable()
+{
+    constexpr size_t max_vertices = IcosphereTable<ORDER>::N_VERTICES;
+    constexpr size_t max_slots = 3 * IcosphereTable<ORDER>::N_TRIANGLES;
+
+    IcosphereTable<ORDER> table{};
+    auto& vertices = table.vertices;
+    auto& indices = table.indices;
+
+    // Icosahedron with Y as up vector: two rings of 5 vertices at elevation +-atan(1/2), the
+    // lower one turned by 36 degrees. Sines and cosines of multiples of 36 degrees are exact.
+    const double sqrt5 = constexprSqrt(5.0);
+    const double cos36 = (1.0 + sqrt5) / 4.0;
+    const double sin36 = constexprSqrt(10.0 - 2.0 * sqrt5) / 4.0;
+    const double cos72 = (sqrt5 - 1.0) / 4.0;
+    const double sin72 = constexprSqrt(10.0 + 2.0 * sqrt5) / 4.0;
+    const double cos_theta[10] = {1.0, cos36, cos72, -cos72, -cos36, -1.0, -cos36, -cos72, cos72, cos36};
+    const double sin_theta[10] = {0.0, sin36, sin72, sin72, sin36, 0.0, -sin36, -sin72, -sin72, -sin36};
+    const double ring_y = 1.0 / sqrt5;
+    const double ring_radius = 2.0 / sqrt5;
+
+    vertices[0] = sphereVertexData(0.0, 1.0, 0.0);
+    for (size_t k = 0; k < 5; ++k)
+        vertices[1 + k] = sphereVertexData(ring_radius * sin_theta[2*k], ring_y, ring_radius * cos_theta[2*k]);
+    for (size_t k = 0; k < 5; ++k)
+        vertices[6 + k] = sphereVertexData(ring_radius * sin_theta[2*k + 1], -ring_y, ring_radius * cos_theta[2*k + 1]);
+    vertices[11] = sphereVertexData(0.0, -1.0, 0.0);
+
+    const unsigned int icosahedron_indices[60] = {
+        // Top part.
+        0,1,2,  0,2,3,  0,3,4,  0,4,5,  0,5,1,
+        // Middle part.
+        1,6,2,  2,6,7,  2,7,3,  3,7,8,  3,8,4,  4,8,9,  4,9,5,  5,9,10,  5,10,1,  1,10,6,
+        // Bottom part.
+        11,7,6,  11,8,7,  11,9,8,  11,10,9,  11,6,10
+    };
+    for (size_t i = 0; i < 60; ++i)
+        indices[i] = icosahedron_indices[i];
+
+    size_t n_vertices = 12;
+    size_t n_slots = 60;
+
+    // Subdivide in place, numbering midpoints like subdivide(): unique edges sorted by lowest then
+    // highest vertex.
+    std::array<unsigned int, max_vertices + 1> bucket_begin{};
+    std::array<unsigned int, max_slots> bucket_slots{};
+    std::array<unsigned int, max_slots> midpoint_of_slot{};
+    std::array<unsigned int, max_slots> new_indices{};
+
+    for (int level = 0; level < ORDER; ++level) {
+        auto lowEnd = [&](size_t slot) {
+            const unsigned int a = indices[slot];
+            const unsigned int b = indices[slot - slot % 3 + (slot + 1) % 3];
+            return a < b ? a : b;
+        };
+        auto highEnd = [&](size_t slot) {
+            const unsigned int a = indices[slot];
+            const unsigned int b = indices[slot - slot % 3 + (slot + 1) % 3];
+            return a < b ? b : a;
+        };
+
+        // Bucket the edge slots by lowest vertex (counting sort).
+        for (size_t v = 0; v <= n_vertices; ++v)
+            bucket_begin[v] = 0;
+        for (size_t slot = 0; slot < n_slots; ++slot)
+            bucket_begin[lowEnd(slot) + 1]++;
+        for (size_t v = 0; v < n_vertices; ++v)
+            bucket_begin[v + 1] += bucket_begin[v];
+        for (size_t slot = 0; slot < n_slots; ++slot)
+            bucket_slots[bucket_begin[lowEnd(slot)]++] = static_cast<unsigned int>(slot);
+        for (size_t v = n_vertices; v > 0; --v)
+            bucket_begin[v] = bucket_begin[v - 1];
+        bucket_begin[0] = 0;
+
+        // Sort each bucket by highest vertex, then create one midpoint per unique edge. Buckets
+        // hold a few slots only, so insertion sort is enough.
+        size_t midpoint = n_vertices;
+        for (size_t v = 0; v < n_vertices; ++v) {
+            for (size_t i = bucket_begin[v] + 1; i < bucket_begin[v + 1]; ++i) {
+                const unsigned int slot = bucket_slots[i];
+                size_t j = i;
+                for (; j > bucket_begin[v] && highEnd(bucket_slots[j - 1]) > highEnd(slot); --j)
+                    bucket_slots[j] = bucket_slots[j - 1];
+                bucket_slots[j] = slot;
+            }
+
+            unsigned int previous_end = static_cast<unsigned int>(-1);
+            for (size_t i = bucket_begin[v]; i < bucket_begin[v + 1]; ++i) {
+                const unsigned int slot = bucket_slots[i];
+                const unsigned int high = highEnd(slot);
+                if (high != previous_end) {
+                    previous_end = high;
+                    const VertexData& a = vertices[v];
+                    const VertexData& b = vertices[high];
+                    vertices[midpoint++] = sphereVertexData(0.5 * (double{a.pos[0]} + b.pos[0]),
+                                                            0.5 * (double{a.pos[1]} + b.pos[1]),
+                                                            0.5 * (double{a.pos[2]} + b.pos[2]));
+                }
+                midpoint_of_slot[slot] = static_cast<unsigned int>(midpoint - 1);
+            }
+        }
+
+        // Replace each triangle with four, as subdivide() does.
+        for (size_t t = 0; t < n_slots / 3; ++t) {
+            const unsigned int* index = &indices[3*t];
+            const unsigned int* new_pos_index = &midpoint_of_slot[3*t];
+            unsigned int* triangles = &new_indices[12*t];
+            triangles[0] = index[0];          triangles[1] = new_pos_index[0];  triangles[2] = new_pos_index[2];
+            triangles[3] = new_pos_index[0];  triangles[4] = index[1];          triangles[5] = new_pos_index[1];
+            triangles[6] = new_pos_index[2];  triangles[7] = new_pos_index[1];  triangles[8] = index[2];
+            triangles[9] = new_pos_index[0];  triangles[10] = new_pos_index[1]; triangles[11] = new_pos_index[2];
+        }
+
+        n_vertices = midpoint;
+        n_slots *= 4;
+        for (size_t i = 0; i < n_slots; ++i)
+            indices[i] = new_indices[i];
+    }
+
+    return table;
+}
+
+#endif // GEOMETRY_TABLES_HPP
@@ -0,0 +1,116 @@
+#include "GlState.hpp"
+
+#include <cassert>
+#include <climits>
+
+#include <glad/glad.h>
+
+// Texture units tracked by the cache. Higher units are not used by the renderer.
+static constexpr int MAX_TEXTURE_UNITS = 16;
+
+// Value of a binding which is not known, and must be set on the next call.
+static constexpr unsigned int UNKNOWN = UINT_MAX;
+
+struct CachedState
+{
+    unsigned int program = UNKNOWN;
+    unsigned int vao = UNKNOWN;
+    unsigned int framebuffer = UNKNOWN;
+    int active_unit = -1;
+    unsigned int textures[MAX_TEXTURE_UNITS];
+    int viewport[4] = {-1, -1, -1, -1};
+
+    CachedState()
+    {
+        for (auto& texture : textures)
+            texture = UNKNOWN;
+    }
+};
+
+static CachedState state;
+static GlState::Counters counters_;
+
+// Update a cached value, and return whether the matching call must be issued.
+template <typename T>
+static bool update(T& cached, T value)
+{
+    if (cached == value) {
+        counters_.filtered_calls++;
+        return false;
+    }
+    cached = value;
+    counters_.issued_calls++;
+    return true;
+}
+
+
+void GlState::useProgram(unsigned int program)
+{
+    if (update(state.program, program))
+        glUseProgram(program);
+}
+
+void GlState::bindVertexArray(unsigned int vao)
+{
+    if (update(state.vao, vao))
+        glBindVertexArray(vao);
+}
+
+void GlState::bindTexture(int unit, unsigned int texture)
+{
+    assert(unit >= 0 && unit < MAX_TEXTURE_UNITS);
+
+    if (state.textures[unit] == texture) {
+        counters_.filtered_calls++;
+        return;
+    }
+    // The active unit only matters for the bind itself.
+    if (update(state.active_unit, unit))
+        glActiveTexture(GL_TEXTURE0 + unit);
+    if (update(state.textures[unit], texture))
+        glBindTexture(GL_TEXTURE_2D, texture);
+}
+
+void GlState::bindFramebuffer(unsigned int framebuffer)
+{
+    if (update(state.framebuffer, framebuffer))
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+}
+
+void GlState::viewport(int x, int y, int width, int height)
+{
+    int* cached = state.viewport;
+    if (cached[0] == x && cached[1] == y && cached[2] == width && cached[3] == height) {
+        counters_.filtered_calls++;
+        return;
+    }
+    cached[0] = x;
+    cached[1] = y;
+    cached[2] = width;
+    cached[3] = height;
+    counters_.issued_calls++;
+    glViewport(x, y, width, height);
+}
+
+void GlState::deleteVertexArray(unsigned int vao)
+{
+    glDeleteVertexArrays(1, &vao);
+    // Its name may be reused by the next VAO created, which must then be bound again.
+    if (state.vao == vao)
+        state.vao = 0;
+}
+
+void GlState::invalidate()
+{
+    state = CachedState();
+}
+
+const GlState::Counters& GlState::counters()
+{
+    return counters_;
+}
+
+void GlState::resetCounters()
+{
+    counters_ = Counters();
+}
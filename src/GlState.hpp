@@ -0,0 +1,38 @@
+#ifndef GL_STATE_HPP
+#define GL_STATE_HPP
+
+// Shadow copy of the OpenGL bindings changed while rendering.
+//
+// Every bind goes through here, so calls which would not change the current binding are dropped
+// before reaching the driver. The cache is only valid as long as nothing else binds these
+// objects: code calling OpenGL directly must either restore the previous bindings (as the ImGui
+// backend does) or call invalidate() afterwards.
+class GlState
+{
+public:
+
+    // Number of issued and dropped calls since the last resetCounters().
+    struct Counters
+    {
+        int issued_calls = 0;
+        int filtered_calls = 0;
+    };
+
+    static void useProgram(unsigned int program);
+    static void bindVertexArray(unsigned int vao);
+    // Bind a 2D texture to a texture unit, selecting that unit first if needed.
+    static void bindTexture(int unit, unsigned int texture);
+    static void bindFramebuffer(unsigned int framebuffer);
+    static void viewport(int x, int y, int width, int height);
+
+    // Delete a vertex array. If it was bound, the binding reverts to 0.
+    static void deleteVertexArray(unsigned int vao);
+
+    // Forget the cached state, so the next call of each kind is always issued.
+    static void invalidate();
+
+    static const Counters& counters();
+    static void resetCounters();
+};
+
+#endif // GL_STATE_HPP
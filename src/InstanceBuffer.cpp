@@ -0,0 +1,75 @@
+#include "InstanceBuffer.hpp"
+
+#include <glad/glad.h>
+
+#include <cstring>
+
+#include "GlState.hpp"
+#include "StreamBuffer.hpp"
+
+using namespace std;
+
+// First attribute location of the instance data.
+static const unsigned int MODEL_LOCATION = 3;
+static const unsigned int NORMAL_MATRIX_LOCATION = 7;
+static const unsigned int MATERIAL_LOCATION = 10;
+
+static_assert(sizeof(InstanceData) == 26 * sizeof(float), "InstanceData must be tightly packed");
+
+// Alignment of the instances in the stream buffer.
+static const size_t INSTANCE_ALIGNMENT = 16;
+
+InstanceBuffer::InstanceBuffer():
+    id_(0), offset_(0)
+{
+}
+
+size_t InstanceBuffer::streamSize(size_t count)
+{
+    return count * sizeof(InstanceData) + INSTANCE_ALIGNMENT;
+}
+
+void InstanceBuffer::update(StreamBuffer& stream, const vector<InstanceData>& instances)
+{
+    if (instances.empty())
+        return;
+
+    const size_t size = instances.size() * sizeof(InstanceData);
+    const StreamBuffer::Range range = stream.allocate(size, INSTANCE_ALIGNMENT);
+    memcpy(range.data, instances.data(), size);
+    id_ = stream.getId();
+    offset_ = range.offset;
+}
+
+void InstanceBuffer::attach(unsigned int vao, size_t first_instance) const
+{
+    GlState::bindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, id_);
+
+    const size_t stride = sizeof(InstanceData);
+    const size_t base = offset_ + first_instance * stride;
+
+    // Matrices take one attribute location per column.
+    for (unsigned int column = 0; column < 4; ++column) {
+        const unsigned int location = MODEL_LOCATION + column;
+        const size_t offset = base + offsetof(InstanceData, model) + column * 4 * sizeof(float);
+        glEnableVertexAttribArray(location);
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, stride, (void*)offset);
+        glVertexAttribDivisor(location, 1);
+    }
+    for (unsigned int column = 0; column < 3; ++column) {
+        const unsigned int location = NORMAL_MATRIX_LOCATION + column;
+        const size_t offset = base + offsetof(InstanceData, normal_matrix) + column * 3 * sizeof(float);
+        glEnableVertexAttribArray(location);
+        glVertexAttribPointer(location, 3, GL_FLOAT, GL_FALSE, stride, (void*)offset);
+        glVertexAttribDivisor(location, 1);
+    }
+    {
+        const size_t offset = base + offsetof(InstanceData, material);
+        glEnableVertexAttribArray(MATERIAL_LOCATION);
+        glVertexAttribIPointer(MATERIAL_LOCATION, 1, GL_INT, stride, (void*)offset);
+        glVertexAttribDivisor(MATERIAL_LOCATION, 1);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
@@ -0,0 +1,52 @@
+#ifndef INSTANCE_BUFFER_HPP
+#define INSTANCE_BUFFER_HPP
+
+#include <cstddef>
+#include <vector>
+
+#include <glm/mat3x3.hpp>
+#include <glm/mat4x4.hpp>
+
+class StreamBuffer;
+
+// Per instance data of an instanced draw, as read by the INSTANCED shader variants.
+struct InstanceData
+{
+    glm::mat4 model;
+    glm::mat3 normal_matrix;
+    // Index in the material table.
+    int material;
+};
+
+// Per instance attributes of a frame, written to the region of the frame in a stream buffer.
+//
+// Instances of one draw must be contiguous in the buffer. OpenGL 4.0 has no base instance, so
+// the instance attributes of a mesh VAO are pointed at the first instance of each draw instead:
+// locations 3-6 hold the model matrix, locations 7-9 the normal matrix and location 10 the
+// material index, one per instance.
+class InstanceBuffer
+{
+private:
+    // Stream buffer holding the instances of the frame, and offset of the first one in it.
+    unsigned int id_;
+    size_t offset_;
+
+public:
+    InstanceBuffer();
+    ~InstanceBuffer() = default;
+
+    InstanceBuffer(const InstanceBuffer&) = delete;
+    InstanceBuffer& operator=(const InstanceBuffer&) = delete;
+
+    // Bytes taken by `count` instances in a stream buffer.
+    static size_t streamSize(size_t count);
+
+    // Write the instances of the frame to the stream buffer, which must be between beginFrame()
+    // and endWrites().
+    void update(StreamBuffer& stream, const std::vector<InstanceData>& instances);
+
+    // Bind the VAO of a mesh and read its instance attributes starting at `first_instance`.
+    void attach(unsigned int vao, size_t first_instance) const;
+};
+
+#endif // INSTANCE_BUFFER_HPP
@@ -11,6 +11,7 @@
 #include "Camera.hpp"
 #include "Math.hpp"
 #include "Geometry.hpp"
+#include "GlState.hpp"
 #include "Renderer.hpp"
 #include "Scene.hpp"
 #include "SimpleGui.hpp"
@@ -107,89 +108,103 @@ int main()
     //glCullFace(GL_BACK);
     //glFrontFace(GL_CCW);
     //glEnable(GL_CULL_FACE);
-    glViewport(0, 0, window_width, window_height);
+    GlState::viewport(0, 0, window_width, window_height);
     const float aspect_ratio = static_cast<float>(window_width) / window_height;
 
-    TableSceneRenderer renderer(window_width, window_height);
-    RenderParameter render_params;
-
-    // Setup the scene.
-    TableScene scene;
-
-    // Setup camera.
-    Camera camera(aspect_ratio);
-    camera.setPosition(vec3(2.7f, 2.7f, 2.7f));
-    camera.lookAt(vec3(0.0f, 1.1f, 0.0f));
-
-    // Setup Arcball handler.
-    ArcballHandler arcball(window_width, window_height);
-
-    // Setup ImGui and GUI state.
-    setupImGui(window);
-    GuiState gui_state;
-
-    // Main loop.
-    double tick = glfwGetTime();
-    double tock = 0.0;
-    while (!glfwWindowShouldClose(window))
+    // Scene and renderer own GL objects, released when they go out of scope: before the context is
+    // destroyed.
     {
-        // Get time per frame (ms) and FPS.
-        tock = glfwGetTime();
-        auto time_per_frame = 1000.0 * (tock - tick);
-        gui_state.time_per_frame = time_per_frame;
-        tick = tock;
-
-        glfwPollEvents();
-
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        // Create GUI frame.
-        setupGuiFrame(gui_state);
-
-        const vec3 gui_color = hsvToRgb(gui_state.H, gui_state.S, gui_state.V);
-        const vec3 inv_color = hsvToRgb(gui_state.H > 180.f ? gui_state.H - 180.f : gui_state.H + 180.f,
-                                        gui_state.S,
-                                        gui_state.V);
-        scene.sphere_material.kd = gui_color;
-        scene.torus_material. kd = inv_color;
-
-        // GLFW input handling.
-        processInput(window, camera);
-        camera.isPerspective(gui_state.is_perspective);
-
-        // Update render parameters.
-        render_params.ambient = gui_state.ambient;
-        render_params.diffuse = gui_state.diffuse;
-        render_params.specular = gui_state.specular;
-        render_params.teapot_tex = gui_state.teapot_tex;
-
-        // Process arcball motion.
-        arcball.processInput(window);
-        // Transform camera space rotation to world space rotation.
-        const mat4 arc_rotation = glm::inverse(camera.view()) * arcball.getArcRotation();
-        // Move the scene accordingly.
-        scene.root()->ori_x = arc_rotation[0];
-        scene.root()->ori_y = arc_rotation[1];
-        scene.root()->ori_z = arc_rotation[2];
-
-        // World light position.
-        scene.point_light_node->pos = vec3{4*cosf(tock), 6.2f, 4*sinf(tock)};
-
-        // Update camera view before rendering.
-        camera.updateView();
-
-        // Render scene.
-        renderer.renderTableScene(scene, camera, render_params);
-
-        // Render GUI on top.
-        renderGui();
-
-        glfwSwapBuffers(window);
+        TableSceneRenderer renderer(window_width, window_height);
+        RenderParameter render_params;
+
+        // Setup the scene.
+        TableScene scene;
+
+        // Setup camera.
+        Camera camera(aspect_ratio);
+        camera.setPosition(vec3(2.7f, 2.7f, 2.7f));
+        camera.lookAt(vec3(0.0f, 1.1f, 0.0f));
+
+        // Setup Arcball handler.
+        ArcballHandler arcball(window_width, window_height);
+
+        // Setup ImGui and GUI state.
+        setupImGui(window);
+        GuiState gui_state;
+
+        // Main loop.
+        double tick = glfwGetTime();
+        double tock = 0.0;
+        while (!glfwWindowShouldClose(window))
+        {
+            // Get time per frame (ms) and FPS.
+            tock = glfwGetTime();
+            auto time_per_frame = 1000.0 * (tock - tick);
+            gui_state.time_per_frame = time_per_frame;
+            tick = tock;
+
+            glfwPollEvents();
+
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+            // Create GUI frame, showing the counters of the previous frame.
+            gui_state.draws = renderer.stats().draws;
+            gui_state.state_changes = renderer.stats().stateChanges();
+            gui_state.stream_stalls = renderer.stats().stream_stalls;
+            gui_state.culled_draws = renderer.stats().culled_draws;
+            gui_state.filtered_gl_calls = GlState::counters().filtered_calls;
+            GlState::resetCounters();
+            setupGuiFrame(gui_state);
+
+            const vec3 gui_color = hsvToRgb(gui_state.H, gui_state.S, gui_state.V);
+            const vec3 inv_color = hsvToRgb(gui_state.H > 180.f ? gui_state.H - 180.f : gui_state.H + 180.f,
+                                            gui_state.S,
+                                            gui_state.V);
+            scene.materials[scene.sphere_material].kd = gui_color;
+            scene.materials[scene.torus_material].kd = inv_color;
+            scene.teapot_node->texture = gui_state.teapot_tex;
+
+            // GLFW input handling.
+            processInput(window, camera);
+            camera.isPerspective(gui_state.is_perspective);
+
+            // Update render parameters.
+            render_params.ambient = gui_state.ambient;
+            render_params.diffuse = gui_state.diffuse;
+            render_params.specular = gui_state.specular;
+            render_params.multi_draw_indirect = gui_state.multi_draw_indirect;
+            render_params.hardware_tessellation = gui_state.hardware_tessellation;
+            render_params.static_batching = gui_state.static_batching;
+            render_params.frustum_culling = gui_state.frustum_culling;
+
+            // Process arcball motion.
+            arcball.processInput(window);
+            // Transform camera space rotation to world space rotation.
+            const mat4 arc_rotation = glm::inverse(camera.view()) * arcball.getArcRotation();
+            // Move the scene accordingly.
+            scene.root()->setOrientation(vec3(arc_rotation[0]),
+                                         vec3(arc_rotation[1]),
+                                         vec3(arc_rotation[2]));
+
+            // World light position.
+            scene.point_light_node->setPosition(vec3{4*cosf(tock), 6.2f, 4*sinf(tock)});
+
+            // Update camera view before rendering.
+            camera.updateView();
+
+            // Render scene.
+            renderer.renderTableScene(scene, camera, render_params);
+
+            // Render GUI on top.
+            renderGui();
+
+            glfwSwapBuffers(window);
+        }
+
+        // ImGui cleanup.
+        terminateImGui();
     }
 
-    // ImGui cleanup.
-    terminateImGui();
-
     // GLFW cleanup.
     glfwDestroyWindow(window);
     glfwTerminate();
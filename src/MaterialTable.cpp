@@ -0,0 +1,49 @@
+#include "MaterialTable.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>    // for std::memcmp
+
+#include "Scene.hpp"
+
+using namespace std;
+using glm::vec4;
+
+MaterialTable::MaterialTable(unsigned int binding):
+    ubo_(MAX_MATERIALS * sizeof(GpuMaterial), binding),
+    uploaded_()
+{
+    static_assert(sizeof(GpuMaterial) == 48, "GpuMaterial must follow std140");
+}
+
+void MaterialTable::update(const vector<PhongMaterial>& materials)
+{
+    assert(materials.size() <= MAX_MATERIALS);
+
+    // Find the range of materials that changed since the last upload.
+    size_t first_changed = materials.size();
+    size_t last_changed = 0;
+    for (size_t i = 0; i < materials.size(); ++i) {
+        const PhongMaterial& m = materials[i];
+        const GpuMaterial gpu_material = {vec4(m.ka, 0.0f), vec4(m.kd, 0.0f), vec4(m.ks, m.shiny)};
+
+        if (i == uploaded_.size()) {
+            uploaded_.push_back(gpu_material);
+        }
+        else if (memcmp(&gpu_material, &uploaded_[i], sizeof(GpuMaterial)) != 0) {
+            uploaded_[i] = gpu_material;
+        }
+        else {
+            continue;
+        }
+        first_changed = min(first_changed, i);
+        last_changed = i;
+    }
+
+    if (first_changed > last_changed)
+        return;
+
+    ubo_.update(&uploaded_[first_changed],
+                (last_changed - first_changed + 1) * sizeof(GpuMaterial),
+                first_changed * sizeof(GpuMaterial));
+}
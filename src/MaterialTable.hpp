@@ -0,0 +1,43 @@
+#ifndef MATERIAL_TABLE_HPP
+#define MATERIAL_TABLE_HPP
+
+#include <cstddef>
+#include <vector>
+
+#include <glm/vec4.hpp>
+
+#include "UniformBuffer.hpp"
+
+struct PhongMaterial;
+
+// GPU resident copy of a list of Phong materials, read by shaders through the Materials uniform
+// block. Draws then only select a material by index.
+// The buffer is only written when a material actually changes, and only the changed range is sent.
+class MaterialTable
+{
+public:
+
+    // Maximum number of materials, must match MAX_MATERIALS in the shaders.
+    static constexpr size_t MAX_MATERIALS = 64;
+
+    MaterialTable(unsigned int binding);
+
+    // Upload the materials which differ from the last uploaded ones.
+    void update(const std::vector<PhongMaterial>& materials);
+
+private:
+
+    // Material in std140 layout. Shininess is packed in the 4th component of ks.
+    struct GpuMaterial
+    {
+        glm::vec4 ka;
+        glm::vec4 kd;
+        glm::vec4 ks_shiny;
+    };
+
+    UniformBuffer ubo_;
+    // Last uploaded content of the buffer.
+    std::vector<GpuMaterial> uploaded_;
+};
+
+#endif // MATERIAL_TABLE_HPP
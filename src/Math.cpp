@@ -1,9 +1,17 @@
 #include "Math.hpp"
 
+#include <algorithm>
+#include <cassert>
 #include <cmath>
 
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MATH_USE_SSE
+#endif
+
 using glm::vec3;
 using glm::vec4;
+using glm::mat3;
 using glm::mat4;
 using glm::cross;
 using glm::normalize;
@@ -107,6 +115,205 @@ mat4 getTranslation(const vec3& u)
 }
 
 
+// Scalar version of composeTransforms(), for a single transformation.
+static void composeTransform(const vec3& pos,
+                             const vec3& ori_x,
+                             const vec3& ori_y,
+                             const vec3& ori_z,
+                             const vec3& scale,
+                             mat4& out_transform,
+                             mat3* out_normal_matrix)
+{
+    // Columns of the upper 3x3 block: rotation axes scaled by each scale factor.
+    const vec3 c0 = normalize(ori_x) * scale.x;
+    const vec3 c1 = normalize(ori_y) * scale.y;
+    const vec3 c2 = normalize(ori_z) * scale.z;
+
+    out_transform[0] = vec4(c0, 0.0f);
+    out_transform[1] = vec4(c1, 0.0f);
+    out_transform[2] = vec4(c2, 0.0f);
+    out_transform[3] = vec4(pos, 1.0f);
+
+    if (out_normal_matrix != nullptr) {
+        // The inverse transpose of a 3x3 matrix is its cofactor matrix divided by its determinant.
+        const vec3 n0 = cross(c1, c2);
+        const vec3 n1 = cross(c2, c0);
+        const vec3 n2 = cross(c0, c1);
+        const float inv_det = 1.0f / glm::dot(c0, n0);
+        *out_normal_matrix = mat3(n0 * inv_det, n1 * inv_det, n2 * inv_det);
+    }
+}
+
+// Below this ratio of the area spanned by the tangents of a Bezier surface sample to the squared
+// length of the longest tangent, the sample is degenerate and has no normal.
+static constexpr float DEGENERATE_SAMPLE_RATIO = 1e-4f;
+
+#ifdef MATH_USE_SSE
+// Three coordinates of four consecutive vectors, one lane per vector.
+struct Vec3x4
+{
+    __m128 x, y, z;
+};
+
+// Load four consecutive vec3 (12 floats) and transpose them to one register per coordinate.
+static Vec3x4 loadVec3x4(const vec3* v)
+{
+    static_assert(sizeof(vec3) == 3 * sizeof(float), "vec3 must be tightly packed");
+    const float* f = &v[0].x;
+    // a = [x0 y0 z0 x1], b = [y1 z1 x2 y2], c = [z2 x3 y3 z3].
+    const __m128 a = _mm_loadu_ps(f);
+    const __m128 b = _mm_loadu_ps(f + 4);
+    const __m128 c = _mm_loadu_ps(f + 8);
+
+    // [b2 b0 c1 c0] then [a0 a3 b2 c1].
+    const __m128 x_bc = _mm_shuffle_ps(b, c, _MM_SHUFFLE(0, 1, 0, 2));
+    const __m128 x = _mm_shuffle_ps(a, x_bc, _MM_SHUFFLE(2, 0, 3, 0));
+    // [a1 a0 b0 b0], [b3 b0 c2 c0], then [a1 b0 b3 c2].
+    const __m128 y_ab = _mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 0, 1));
+    const __m128 y_bc = _mm_shuffle_ps(b, c, _MM_SHUFFLE(0, 2, 0, 3));
+    const __m128 y = _mm_shuffle_ps(y_ab, y_bc, _MM_SHUFFLE(2, 0, 2, 0));
+    // [a2 a0 b1 b0], [c0 c0 c3 c0], then [a2 b1 c0 c3].
+    const __m128 z_ab = _mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 1, 0, 2));
+    const __m128 z_cc = _mm_shuffle_ps(c, c, _MM_SHUFFLE(0, 3, 0, 0));
+    const __m128 z = _mm_shuffle_ps(z_ab, z_cc, _MM_SHUFFLE(2, 0, 2, 0));
+
+    return {x, y, z};
+}
+
+static Vec3x4 mul(const Vec3x4& v, __m128 s)
+{
+    return {_mm_mul_ps(v.x, s), _mm_mul_ps(v.y, s), _mm_mul_ps(v.z, s)};
+}
+
+// acc + v * s, with `v` broadcast to the four lanes.
+static Vec3x4 mulAdd(const Vec3x4& acc, const vec3& v, __m128 s)
+{
+    return {_mm_add_ps(acc.x, _mm_mul_ps(_mm_set1_ps(v.x), s)),
+            _mm_add_ps(acc.y, _mm_mul_ps(_mm_set1_ps(v.y), s)),
+            _mm_add_ps(acc.z, _mm_mul_ps(_mm_set1_ps(v.z), s))};
+}
+
+static __m128 dot(const Vec3x4& a, const Vec3x4& b)
+{
+    return _mm_add_ps(_mm_add_ps(_mm_mul_ps(a.x, b.x), _mm_mul_ps(a.y, b.y)), _mm_mul_ps(a.z, b.z));
+}
+
+static Vec3x4 cross(const Vec3x4& a, const Vec3x4& b)
+{
+    return {_mm_sub_ps(_mm_mul_ps(a.y, b.z), _mm_mul_ps(a.z, b.y)),
+            _mm_sub_ps(_mm_mul_ps(a.z, b.x), _mm_mul_ps(a.x, b.z)),
+            _mm_sub_ps(_mm_mul_ps(a.x, b.y), _mm_mul_ps(a.y, b.x))};
+}
+
+static Vec3x4 normalize(const Vec3x4& v)
+{
+    return mul(v, _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(dot(v, v))));
+}
+
+// Same as the scalar bezierNormal(), for four samples.
+static Vec3x4 bezierNormal(const Vec3x4& du_position, const Vec3x4& dv_position)
+{
+    const Vec3x4 normal = cross(dv_position, du_position);
+    const __m128 longest2 = _mm_max_ps(dot(du_position, du_position), dot(dv_position, dv_position));
+    const __m128 min_area = _mm_mul_ps(_mm_set1_ps(DEGENERATE_SAMPLE_RATIO), longest2);
+    const __m128 regular = _mm_cmpgt_ps(dot(normal, normal), _mm_mul_ps(min_area, min_area));
+    const Vec3x4 unit = normalize(normal);
+    return {_mm_and_ps(unit.x, regular), _mm_and_ps(unit.y, regular), _mm_and_ps(unit.z, regular)};
+}
+
+// Write column `col` of four consecutive matrices, with `w` as fourth coordinate.
+static void storeColumnx4(mat4* out, int col, const Vec3x4& v, __m128 w)
+{
+    __m128 c0 = v.x, c1 = v.y, c2 = v.z, c3 = w;
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+    _mm_storeu_ps(&out[0][col][0], c0);
+    _mm_storeu_ps(&out[1][col][0], c1);
+    _mm_storeu_ps(&out[2][col][0], c2);
+    _mm_storeu_ps(&out[3][col][0], c3);
+}
+
+// Write a 3x3 matrix given as three transposed columns (x, y, z, unused).
+static void storeMat3(mat3& out, __m128 c0, __m128 c1, __m128 c2)
+{
+    float* f = &out[0][0];
+    // The first two stores spill one float into the next column, which is then overwritten.
+    _mm_storeu_ps(f, c0);
+    _mm_storeu_ps(f + 3, c1);
+    _mm_storel_pi(reinterpret_cast<__m64*>(f + 6), c2);
+    _mm_store_ss(f + 8, _mm_movehl_ps(c2, c2));
+}
+
+// Write four consecutive vec3, the inverse of loadVec3x4().
+static void storeVec3x4(vec3* out, const Vec3x4& v)
+{
+    __m128 v0 = v.x, v1 = v.y, v2 = v.z, v3 = _mm_setzero_ps();
+    _MM_TRANSPOSE4_PS(v0, v1, v2, v3);
+    float* f = &out[0].x;
+    // As in storeMat3(), each store but the last spills one float, overwritten by the next one.
+    _mm_storeu_ps(f, v0);
+    _mm_storeu_ps(f + 3, v1);
+    _mm_storeu_ps(f + 6, v2);
+    _mm_storel_pi(reinterpret_cast<__m64*>(f + 9), v3);
+    _mm_store_ss(f + 11, _mm_movehl_ps(v3, v3));
+}
+#endif // MATH_USE_SSE
+
+void composeTransforms(const vec3* pos,
+                       const vec3* ori_x,
+                       const vec3* ori_y,
+                       const vec3* ori_z,
+                       const vec3* scale,
+                       size_t count,
+                       mat4* out_transforms,
+                       mat3* out_normal_matrices)
+{
+    size_t i = 0;
+
+#ifdef MATH_USE_SSE
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+
+    for (; i + 4 <= count; i += 4) {
+        const Vec3x4 s = loadVec3x4(scale + i);
+        const Vec3x4 c0 = mul(normalize(loadVec3x4(ori_x + i)), s.x);
+        const Vec3x4 c1 = mul(normalize(loadVec3x4(ori_y + i)), s.y);
+        const Vec3x4 c2 = mul(normalize(loadVec3x4(ori_z + i)), s.z);
+
+        mat4* out = out_transforms + i;
+        storeColumnx4(out, 0, c0, zero);
+        storeColumnx4(out, 1, c1, zero);
+        storeColumnx4(out, 2, c2, zero);
+        storeColumnx4(out, 3, loadVec3x4(pos + i), one);
+
+        if (out_normal_matrices != nullptr) {
+            const Vec3x4 n0 = cross(c1, c2);
+            const __m128 inv_det = _mm_div_ps(one, dot(c0, n0));
+            __m128 n[3][4];
+            const Vec3x4 cols[3] = {mul(n0, inv_det),
+                                    mul(cross(c2, c0), inv_det),
+                                    mul(cross(c0, c1), inv_det)};
+            for (int col = 0; col < 3; ++col) {
+                n[col][0] = cols[col].x;
+                n[col][1] = cols[col].y;
+                n[col][2] = cols[col].z;
+                n[col][3] = zero;
+                _MM_TRANSPOSE4_PS(n[col][0], n[col][1], n[col][2], n[col][3]);
+            }
+            for (int lane = 0; lane < 4; ++lane) {
+                storeMat3(out_normal_matrices[i + lane], n[0][lane], n[1][lane], n[2][lane]);
+            }
+        }
+    }
+#endif // MATH_USE_SSE
+
+    // Remaining transformations, or all of them without SSE.
+    for (; i < count; ++i) {
+        composeTransform(pos[i], ori_x[i], ori_y[i], ori_z[i], scale[i],
+                         out_transforms[i],
+                         out_normal_matrices != nullptr ? &out_normal_matrices[i] : nullptr);
+    }
+}
+
 // Convertion from HSV to RGB.
 vec3 hsvToRgb(float h, float s, float v)
 {
@@ -188,8 +395,7 @@ float bernstein(int n, int i, float x)
         return 1.0f;
     }
 
-    float binomial = static_cast<float>(factorial(n) / (factorial(i) * factorial(n - i)));
-    return binomial * powf(x, i) * powf(1.0f-x, n-i);
+    return static_cast<float>(binomial(n, i)) * powf(x, i) * powf(1.0f-x, n-i);
 }
 
 // Derivative of the Bernstein polynomial.
@@ -239,3 +445,146 @@ tuple<vec3, vec3> bezierSurfaceSample(const vector<vec3>& control_points,
 
     return make_tuple(position, normal);
 }
+
+// Binomial coefficients of the cubic Bernstein basis and of its derivative, which is quadratic.
+static constexpr float CUBIC_BINOMIALS[4] = {binomial(3, 0), binomial(3, 1), binomial(3, 2), binomial(3, 3)};
+static constexpr float QUADRATIC_BINOMIALS[3] = {binomial(2, 0), binomial(2, 1), binomial(2, 2)};
+static_assert(CUBIC_BINOMIALS[1] == 3.0f && QUADRATIC_BINOMIALS[1] == 2.0f, "wrong binomials");
+
+BernsteinTable::BernsteinTable(int p_degree, int p_n_samples):
+    degree(p_degree),
+    n_samples(p_n_samples),
+    params(p_n_samples),
+    basis((p_degree + 1) * p_n_samples),
+    derivative((p_degree + 1) * p_n_samples)
+{
+    assert(degree >= 0);
+    assert(n_samples >= 1);
+
+    // Binomials of degree n and n - 1. Compile time constants in the common cubic case.
+    vector<float> binomials(degree + 1);
+    vector<float> d_binomials(max(degree, 1));
+    if (degree == 3) {
+        copy(begin(CUBIC_BINOMIALS), end(CUBIC_BINOMIALS), binomials.begin());
+        copy(begin(QUADRATIC_BINOMIALS), end(QUADRATIC_BINOMIALS), d_binomials.begin());
+    }
+    else {
+        for (int i = 0; i <= degree; ++i)
+            binomials[i] = static_cast<float>(binomial(degree, i));
+        for (int i = 0; i < degree; ++i)
+            d_binomials[i] = static_cast<float>(binomial(degree - 1, i));
+    }
+
+    vector<float> t_pow(degree + 1);
+    vector<float> s_pow(degree + 1);
+    for (int s = 0; s < n_samples; ++s) {
+        // Computed rather than accumulated, so the last sample is exactly 1.
+        const float t = n_samples > 1 ? static_cast<float>(s) / (n_samples - 1) : 0.0f;
+        params[s] = t;
+
+        // Powers of t and (1 - t).
+        t_pow[0] = 1.0f;
+        s_pow[0] = 1.0f;
+        for (int k = 1; k <= degree; ++k) {
+            t_pow[k] = t_pow[k - 1] * t;
+            s_pow[k] = s_pow[k - 1] * (1.0f - t);
+        }
+
+        for (int i = 0; i <= degree; ++i) {
+            basis[i*n_samples + s] = binomials[i] * t_pow[i] * s_pow[degree - i];
+
+            // d/dt B(n, i) = n * (B(n-1, i-1) - B(n-1, i)).
+            float d = 0.0f;
+            if (i > 0)
+                d += d_binomials[i - 1] * t_pow[i - 1] * s_pow[degree - i];
+            if (i < degree)
+                d -= d_binomials[i] * t_pow[i] * s_pow[degree - 1 - i];
+            derivative[i*n_samples + s] = degree * d;
+        }
+    }
+}
+
+// Unit normal of a Bezier surface sample, -(du x dv) = dv x du, or zero if the sample is
+// degenerate, e.g. at the pole of a patch where a whole row of control points is one point.
+static vec3 bezierNormal(const vec3& du_position, const vec3& dv_position)
+{
+    const vec3 normal = cross(dv_position, du_position);
+    const float longest2 = max(glm::dot(du_position, du_position), glm::dot(dv_position, dv_position));
+    const float min_area = DEGENERATE_SAMPLE_RATIO * longest2;
+    if (glm::dot(normal, normal) <= min_area * min_area)
+        return vec3(0.0f);
+    return normalize(normal);
+}
+
+void evaluateBezierSurface(const vector<vec3>& control_points,
+                           const BernsteinTable& u_table,
+                           const BernsteinTable& v_table,
+                           int row_begin,
+                           int row_end,
+                           vec3* out_positions,
+                           vec3* out_normals)
+{
+    const int rows = u_table.degree + 1;
+    const int cols = v_table.degree + 1;
+    const int n_u = u_table.n_samples;
+    const int n_v = v_table.n_samples;
+    assert(control_points.size() == static_cast<size_t>(rows * cols));
+    assert(row_begin >= 0 && row_end <= n_u);
+
+    // Control points of the curve along v at the current u, and of its derivative with respect to u.
+    vector<vec3> curve(cols);
+    vector<vec3> du_curve(cols);
+
+    for (int i = row_begin; i < row_end; ++i) {
+        fill(curve.begin(), curve.end(), vec3(0.0f));
+        fill(du_curve.begin(), du_curve.end(), vec3(0.0f));
+        for (int r = 0; r < rows; ++r) {
+            const float bern_r = u_table.basis[r*n_u + i];
+            const float d_bern_r = u_table.derivative[r*n_u + i];
+            for (int c = 0; c < cols; ++c) {
+                curve[c] += bern_r * control_points[r*cols + c];
+                du_curve[c] += d_bern_r * control_points[r*cols + c];
+            }
+        }
+
+        vec3* positions = out_positions + static_cast<size_t>(i - row_begin) * n_v;
+        vec3* normals = out_normals + static_cast<size_t>(i - row_begin) * n_v;
+        int j = 0;
+
+#ifdef MATH_USE_SSE
+        const __m128 zero = _mm_setzero_ps();
+        for (; j + 4 <= n_v; j += 4) {
+            Vec3x4 position = {zero, zero, zero};
+            Vec3x4 du_position = {zero, zero, zero};
+            Vec3x4 dv_position = {zero, zero, zero};
+            for (int c = 0; c < cols; ++c) {
+                const __m128 bern_c = _mm_loadu_ps(&v_table.basis[c*n_v + j]);
+                const __m128 d_bern_c = _mm_loadu_ps(&v_table.derivative[c*n_v + j]);
+                position = mulAdd(position, curve[c], bern_c);
+                du_position = mulAdd(du_position, du_curve[c], bern_c);
+                dv_position = mulAdd(dv_position, curve[c], d_bern_c);
+            }
+
+            storeVec3x4(positions + j, position);
+            storeVec3x4(normals + j, bezierNormal(du_position, dv_position));
+        }
+#endif // MATH_USE_SSE
+
+        // Remaining samples, or all of them without SSE.
+        for (; j < n_v; ++j) {
+            vec3 position{0.0f};
+            vec3 du_position{0.0f};
+            vec3 dv_position{0.0f};
+            for (int c = 0; c < cols; ++c) {
+                const float bern_c = v_table.basis[c*n_v + j];
+                const float d_bern_c = v_table.derivative[c*n_v + j];
+                position += bern_c * curve[c];
+                du_position += bern_c * du_curve[c];
+                dv_position += d_bern_c * curve[c];
+            }
+
+            positions[j] = position;
+            normals[j] = bezierNormal(du_position, dv_position);
+        }
+    }
+}
@@ -1,6 +1,7 @@
 #ifndef MATH_HPP
 #define MATH_HPP
 
+#include <cstddef>
 #include <cstdint>
 #include <tuple>
 #include <vector>
@@ -30,6 +31,21 @@ glm::mat4 getScale(const glm::vec3& u);
 // Create translation matrix.
 glm::mat4 getTranslation(const glm::vec3& u);
 
+// Batched composition of translation * rotation * scale matrices, written out directly instead of
+// multiplying three 4x4 matrices. Element i of every input array describes transformation i, and
+// the orientation axes are normalized as in getRotation().
+// If `out_normal_matrices` is not null, the normal matrix of each transformation (the inverse
+// transpose of its upper 3x3 block) is computed in the same pass.
+// Uses SSE when available, four transformations at a time.
+void composeTransforms(const glm::vec3* pos,
+                       const glm::vec3* ori_x,
+                       const glm::vec3* ori_y,
+                       const glm::vec3* ori_z,
+                       const glm::vec3* scale,
+                       size_t count,
+                       glm::mat4* out_transforms,
+                       glm::mat3* out_normal_matrices = nullptr);
+
 // Convertion from HSV to RGB.
 // Inputs:
 // - H in range [0, 360.0];
@@ -41,10 +57,67 @@ glm::vec3 hsvToRgb(float h, float s, float v);
 // Simple factorial.
 uint64_t factorial(int n);
 
+// Binomial coefficient "n choose k", usable in constant expressions.
+constexpr uint64_t binomial(int n, int k)
+{
+    if (k < 0 || k > n)
+        return 0;
+
+    uint64_t result = 1;
+    for (int i = 1; i <= k; ++i)
+        result = result * static_cast<uint64_t>(n - k + i) / static_cast<uint64_t>(i);
+    return result;
+}
+
+// Square root usable in constant expressions, by Newton's method from above.
+constexpr double constexprSqrt(double x)
+{
+    if (x <= 0.0)
+        return 0.0;
+
+    double root = x > 1.0 ? x : 1.0;
+    while (true) {
+        const double next = 0.5 * (root + x / root);
+        if (!(next < root))
+            return root;
+        root = next;
+    }
+}
+
 // Bernstein polynomial and its derivative.
 float bernstein(int n, int i, float x);
 float d_bernstein(int n, int i, float x);
 
+// Bernstein basis of one degree and its derivative, tabulated at evenly spaced parameters from 0 to
+// 1, so a whole grid of Bezier surface samples is evaluated without computing any polynomial.
+struct BernsteinTable
+{
+    BernsteinTable(int p_degree, int p_n_samples);
+
+    int degree;
+    int n_samples;
+    // Parameter of each sample.
+    std::vector<float> params;
+    // Value of basis polynomial i at sample s in [i * n_samples + s], so that consecutive samples
+    // are contiguous.
+    std::vector<float> basis;
+    std::vector<float> derivative;
+};
+
+// Evaluate a Bezier surface of `u_table.degree + 1` rows and `v_table.degree + 1` columns of
+// control points on the grid of samples of both tables, from row `row_begin` to `row_end`
+// excluded: sample (i, j), at parameters (u_table.params[i], v_table.params[j]), is written at
+// index (i - row_begin) * v_table.n_samples + j.
+// Degenerate samples, where a tangent vanishes, get a zero normal.
+// Uses SSE when available, four samples of a row at a time.
+void evaluateBezierSurface(const std::vector<glm::vec3>& control_points,
+                           const BernsteinTable& u_table,
+                           const BernsteinTable& v_table,
+                           int row_begin,
+                           int row_end,
+                           glm::vec3* out_positions,
+                           glm::vec3* out_normals);
+
 // Compute the position and normal vectors at surface point (u,v).
 std::tuple<glm::vec3, glm::vec3> bezierSurfaceSample(const std::vector<glm::vec3>& control_points,
                                                      int rows,
@@ -1,36 +1,55 @@
 #include "Mesh.hpp"
 
+#include <cassert>
+#include <iostream>
+#include <limits>
+#include <utility>
+
 #include <glad/glad.h>
 
+#include "GlState.hpp"
+#include "MeshOptimizer.hpp"
+
 using namespace std;
+using glm::vec3;
+using glm::mat4;
+
+// Largest vertex count addressable by 16-bit indices.
+static const size_t MAX_SHORT_INDEXED_VERTICES = 65536;
 
-Mesh::Mesh(const vector<Vertex>& p_vertices,
-           const vector<unsigned int>& p_indices):
-    vao_{0}, vbo_{0}, ebo_{0}
+// Copy indices into the bound element buffer, on 16 bits if `use_short` is set.
+static void uploadIndices(const vector<unsigned int>& indices, bool use_short)
 {
-    // Copy vertices to the Mesh object.
-    if (!p_vertices.empty()) {
-        vertices.reserve(p_vertices.size());
-        for (const auto& v : p_vertices)
-            vertices.emplace_back(v);
+    if (use_short) {
+        const vector<uint16_t> short_indices(indices.begin(), indices.end());
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                     short_indices.size() * sizeof(uint16_t),
+                     short_indices.data(),
+                     GL_STATIC_DRAW);
     }
-
-    // Copy indices to the Mesh object.
-    if (!p_indices.empty()) {
-        indices.reserve(p_indices.size());
-        for (const auto& ind : p_indices)
-            indices.emplace_back(ind);
+    else {
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                     indices.size() * sizeof(unsigned int),
+                     indices.data(),
+                     GL_STATIC_DRAW);
     }
-
-    // Create OpenGL objects.
-    glGenVertexArrays(1, &vao_);
-    glGenBuffers(1, &vbo_);
-    glGenBuffers(1, &ebo_);
 }
 
-Mesh::Mesh(const vector<Vertex>& p_vertices):
-    Mesh(p_vertices, {})
+Mesh::Mesh(vector<Vertex> p_vertices,
+           vector<unsigned int> p_indices):
+    vertices(move(p_vertices)),
+    indices(move(p_indices)),
+    vao_{0}, vbo_{0}, ebo_{0},
+    position_vbo_{0}, depth_vao_{0},
+    format_(VertexFormat::FLOAT32),
+    dequantization_(1.0f),
+    index_type_(GL_UNSIGNED_INT),
+    vertex_count_(0),
+    index_count_(0),
+    aabb_(),
+    bounding_sphere_()
 {
+    updateBounds();
 }
 
 Mesh::Mesh():
@@ -38,72 +57,409 @@ Mesh::Mesh():
 {
 }
 
+Mesh::~Mesh()
+{
+    releaseGpu();
+}
+
+Mesh::Mesh(Mesh&& mesh) noexcept:
+    vertices(move(mesh.vertices)),
+    indices(move(mesh.indices)),
+    vao_(mesh.vao_), vbo_(mesh.vbo_), ebo_(mesh.ebo_),
+    position_vbo_(mesh.position_vbo_), depth_vao_(mesh.depth_vao_),
+    format_(mesh.format_),
+    dequantization_(mesh.dequantization_),
+    index_type_(mesh.index_type_),
+    vertex_count_(mesh.vertex_count_),
+    index_count_(mesh.index_count_),
+    aabb_(mesh.aabb_),
+    bounding_sphere_(mesh.bounding_sphere_)
+{
+    mesh.vao_ = mesh.vbo_ = mesh.ebo_ = 0;
+    mesh.position_vbo_ = mesh.depth_vao_ = 0;
+}
+
+Mesh& Mesh::operator=(Mesh&& mesh) noexcept
+{
+    if (this == &mesh)
+        return *this;
+
+    releaseGpu();
+    vertices = move(mesh.vertices);
+    indices = move(mesh.indices);
+    vao_ = mesh.vao_;
+    vbo_ = mesh.vbo_;
+    ebo_ = mesh.ebo_;
+    position_vbo_ = mesh.position_vbo_;
+    depth_vao_ = mesh.depth_vao_;
+    format_ = mesh.format_;
+    dequantization_ = mesh.dequantization_;
+    index_type_ = mesh.index_type_;
+    vertex_count_ = mesh.vertex_count_;
+    index_count_ = mesh.index_count_;
+    aabb_ = mesh.aabb_;
+    bounding_sphere_ = mesh.bounding_sphere_;
+
+    mesh.vao_ = mesh.vbo_ = mesh.ebo_ = 0;
+    mesh.position_vbo_ = mesh.depth_vao_ = 0;
+    return *this;
+}
+
+Mesh Mesh::clone() const
+{
+    return Mesh(vertices, indices);
+}
+
 void Mesh::extend(const Mesh& mesh)
 {
-    if (mesh.indices.empty()) {
-        return;
+    const unsigned int initial_vertex_count = vertices.size();
+
+    // Meshes without indices draw their vertices in order, so they get trivial indices when
+    // merged with indexed meshes.
+    if (indices.empty() && !mesh.indices.empty()) {
+        indices.reserve(initial_vertex_count + mesh.indices.size());
+        for (unsigned int i = 0; i < initial_vertex_count; ++i)
+            indices.push_back(i);
     }
 
-    const unsigned int initial_vertex_count = vertices.size();
+    vertices.insert(vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
 
-    for (const auto& v : mesh.vertices) {
-        vertices.emplace_back(v);
+    if (mesh.indices.empty()) {
+        if (!indices.empty()) {
+            for (unsigned int i = 0; i < mesh.vertices.size(); ++i)
+                indices.push_back(initial_vertex_count + i);
+        }
+        return;
     }
 
+    indices.reserve(indices.size() + mesh.indices.size());
     for (const auto& ind : mesh.indices) {
         indices.emplace_back(initial_vertex_count + ind);
     }
 }
 
-void Mesh::pushToGpu()
+void Mesh::updateBounds()
+{
+    aabb_ = computeAabb(vertices);
+    bounding_sphere_ = computeBoundingSphere(vertices, aabb_);
+}
+
+const Aabb& Mesh::aabb() const
+{
+    return aabb_;
+}
+
+const BoundingSphere& Mesh::boundingSphere() const
+{
+    return bounding_sphere_;
+}
+
+void Mesh::pushToGpu(const MeshUploadOptions& options)
 {
-    assert(vao_ != 0);
-    assert(vbo_ != 0);
-    assert(ebo_ != 0);
     assert(!vertices.empty());
 
-    glBindVertexArray(vao_);
+    if (options.optimize)
+        optimizeMesh(*this);
+    updateBounds();
+
+    // Create OpenGL objects on the first upload.
+    if (vao_ == 0) {
+        glGenVertexArrays(1, &vao_);
+        glGenBuffers(1, &vbo_);
+    }
+    if (ebo_ == 0 && !indices.empty())
+        glGenBuffers(1, &ebo_);
+
+    format_ = options.format;
+    vertex_count_ = vertices.size();
+    index_count_ = indices.size();
+
+    GlState::bindVertexArray(vao_);
 
     // Populate Vertex Buffer Object with vertex data.
     glBindBuffer(GL_ARRAY_BUFFER, vbo_);
-    glBufferData(GL_ARRAY_BUFFER,
-                 vertices.size() * sizeof(Vertex),
-                 vertices.data(),
-                 GL_STATIC_DRAW);
-
-    // Specify vertex positions, on layout location 0.
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    // Specify vertex normals, on layout location 1.
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-    // Specify vertex texture coords, on layout location 2.
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
+    if (format_ == VertexFormat::PACKED) {
+        dequantization_ = computeDequantization(vertices);
+        const vector<PackedVertex> packed = packVertices(vertices, dequantization_);
+        glBufferData(GL_ARRAY_BUFFER,
+                     packed.size() * sizeof(PackedVertex),
+                     packed.data(),
+                     GL_STATIC_DRAW);
+    }
+    else {
+        dequantization_ = mat4(1.0f);
+        glBufferData(GL_ARRAY_BUFFER,
+                     vertices.size() * sizeof(Vertex),
+                     vertices.data(),
+                     GL_STATIC_DRAW);
+    }
+    setVertexAttributes(format_);
 
     // Setup Element Buffer Object if there are indices.
     if (!indices.empty()) {
+        const bool use_short = vertices.size() <= MAX_SHORT_INDEXED_VERTICES;
+        index_type_ = use_short ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-                     indices.size() * sizeof(unsigned int),
-                     indices.data(),
-                     GL_STATIC_DRAW);
+        uploadIndices(indices, use_short);
+    }
+
+    if (options.position_stream) {
+        if (depth_vao_ == 0) {
+            glGenVertexArrays(1, &depth_vao_);
+            glGenBuffers(1, &position_vbo_);
+        }
+
+        GlState::bindVertexArray(depth_vao_);
+        glBindBuffer(GL_ARRAY_BUFFER, position_vbo_);
+        if (format_ == VertexFormat::PACKED) {
+            const vector<PackedPosition> positions = packPositions(vertices, dequantization_);
+            glBufferData(GL_ARRAY_BUFFER,
+                         positions.size() * sizeof(PackedPosition),
+                         positions.data(),
+                         GL_STATIC_DRAW);
+        }
+        else {
+            vector<glm::vec3> positions;
+            positions.reserve(vertices.size());
+            for (const auto& v : vertices)
+                positions.push_back(v.pos);
+            glBufferData(GL_ARRAY_BUFFER,
+                         positions.size() * sizeof(glm::vec3),
+                         positions.data(),
+                         GL_STATIC_DRAW);
+        }
+        setPositionAttribute(format_);
+
+        // Both VAOs share the element buffer.
+        if (!indices.empty())
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_);
+    }
+
+    // Unbind.
+    GlState::bindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+MappedMeshBuffers Mesh::mapGpuBuffers(size_t n_vertices, size_t n_indices)
+{
+    assert(n_vertices > 0);
+
+    if (vao_ == 0) {
+        glGenVertexArrays(1, &vao_);
+        glGenBuffers(1, &vbo_);
+    }
+    if (ebo_ == 0 && n_indices > 0)
+        glGenBuffers(1, &ebo_);
+
+    // A position stream would be out of date.
+    if (depth_vao_ != 0) {
+        GlState::deleteVertexArray(depth_vao_);
+        glDeleteBuffers(1, &position_vbo_);
+        depth_vao_ = position_vbo_ = 0;
+    }
+
+    format_ = VertexFormat::FLOAT32;
+    dequantization_ = mat4(1.0f);
+    vertex_count_ = n_vertices;
+    index_count_ = n_indices;
+
+    // The vertices are never read back, so nothing bounds them.
+    const float infinity = numeric_limits<float>::infinity();
+    aabb_ = Aabb{vec3(-infinity), vec3(infinity)};
+    bounding_sphere_ = BoundingSphere{vec3(0.0f), infinity};
+
+    // Previous contents are discarded, so the driver never waits for draws still reading them.
+    const GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT;
+    MappedMeshBuffers buffers{nullptr, nullptr, n_vertices <= MAX_SHORT_INDEXED_VERTICES};
+
+    GlState::bindVertexArray(vao_);
+    const size_t vertex_bytes = n_vertices * sizeof(Vertex);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+    glBufferData(GL_ARRAY_BUFFER, vertex_bytes, NULL, GL_STATIC_DRAW);
+    buffers.vertices = static_cast<Vertex*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, vertex_bytes, access));
+    setVertexAttributes(format_);
+
+    if (n_indices > 0) {
+        index_type_ = buffers.short_indices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+        const size_t index_bytes = n_indices * (buffers.short_indices ? sizeof(uint16_t) : sizeof(unsigned int));
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_bytes, NULL, GL_STATIC_DRAW);
+        buffers.indices = glMapBufferRange(GL_ELEMENT_ARRAY_BUFFER, 0, index_bytes, access);
+    }
+
+    // Mapping fails when the driver is out of memory. Leave the mesh without GPU buffers, so the
+    // caller can upload its data with pushToGpu() instead.
+    if (buffers.vertices == nullptr || (n_indices > 0 && buffers.indices == nullptr)) {
+        cout << "Failed to map mesh buffers (GL error 0x" << hex << glGetError() << dec << ")." << endl;
+        if (buffers.vertices != nullptr)
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+        if (buffers.indices != nullptr)
+            glUnmapBuffer(GL_ELEMENT_ARRAY_BUFFER);
+        GlState::bindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        releaseGpu();
+        vertex_count_ = index_count_ = 0;
+        updateBounds();
+        return MappedMeshBuffers{nullptr, nullptr, buffers.short_indices};
     }
+    return buffers;
+}
+
+bool Mesh::unmapGpuBuffers()
+{
+    GlState::bindVertexArray(vao_);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+    bool is_intact = glUnmapBuffer(GL_ARRAY_BUFFER) == GL_TRUE;
+    if (index_count_ > 0)
+        is_intact = glUnmapBuffer(GL_ELEMENT_ARRAY_BUFFER) == GL_TRUE && is_intact;
 
     // Unbind.
-    glBindVertexArray(0);
+    GlState::bindVertexArray(0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    return is_intact;
+}
+
+void Mesh::releaseCpu()
+{
+    vector<Vertex>().swap(vertices);
+    vector<unsigned int>().swap(indices);
 }
 
 void Mesh::draw()
 {
-    glBindVertexArray(vao_);
+    drawFrom(vao_, 1);
+}
+
+void Mesh::drawInstanced(int instance_count)
+{
+    drawFrom(vao_, instance_count);
+}
+
+void Mesh::drawDepth()
+{
+    drawFrom(getDepthId(), 1);
+}
+
+void Mesh::drawDepthInstanced(int instance_count)
+{
+    drawFrom(getDepthId(), instance_count);
+}
 
-    if (indices.empty()) {
-        glDrawArrays(GL_TRIANGLES, 0, vertices.size());
+void Mesh::drawFrom(unsigned int vao, int instance_count)
+{
+    GlState::bindVertexArray(vao);
+
+    if (index_count_ == 0) {
+        if (instance_count == 1)
+            glDrawArrays(GL_TRIANGLES, 0, vertex_count_);
+        else
+            glDrawArraysInstanced(GL_TRIANGLES, 0, vertex_count_, instance_count);
     }
     else {
-        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, (void*)0);
+        if (instance_count == 1)
+            glDrawElements(GL_TRIANGLES, index_count_, index_type_, (void*)0);
+        else
+            glDrawElementsInstanced(GL_TRIANGLES, index_count_, index_type_, (void*)0, instance_count);
+    }
+}
+
+void Mesh::releaseGpu()
+{
+    if (vao_ != 0)
+        GlState::deleteVertexArray(vao_);
+    if (depth_vao_ != 0)
+        GlState::deleteVertexArray(depth_vao_);
+
+    const unsigned int buffers[] = {vbo_, ebo_, position_vbo_};
+    for (const unsigned int buffer : buffers) {
+        if (buffer != 0)
+            glDeleteBuffers(1, &buffer);
     }
+
+    vao_ = vbo_ = ebo_ = 0;
+    position_vbo_ = depth_vao_ = 0;
+}
+
+unsigned int Mesh::getId() const
+{
+    return vao_;
+}
+
+unsigned int Mesh::getDepthId() const
+{
+    return depth_vao_ != 0 ? depth_vao_ : vao_;
+}
+
+VertexFormat Mesh::vertexFormat() const
+{
+    return format_;
+}
+
+const mat4& Mesh::dequantization() const
+{
+    return dequantization_;
+}
+
+size_t Mesh::gpuSize() const
+{
+    const size_t vertex_size = format_ == VertexFormat::PACKED ? sizeof(PackedVertex) : sizeof(Vertex);
+    const size_t index_size = index_type_ == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(unsigned int);
+    size_t size = vertex_count_ * vertex_size + index_count_ * index_size;
+    if (depth_vao_ != 0) {
+        const size_t position_size = format_ == VertexFormat::PACKED ? sizeof(PackedPosition)
+                                                                     : sizeof(glm::vec3);
+        size += vertex_count_ * position_size;
+    }
+    return size;
+}
+
+size_t Mesh::gpuVertexCount() const
+{
+    return vertex_count_;
+}
+
+size_t Mesh::gpuIndexCount() const
+{
+    return index_count_;
+}
+
+void Mesh::setVertexAttributes(VertexFormat format)
+{
+    if (format == VertexFormat::PACKED) {
+        const int stride = sizeof(PackedVertex);
+        // Positions, on layout location 0: normalized shorts, w is padding.
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_SHORT, GL_TRUE, stride, (void*)offsetof(PackedVertex, pos));
+        // Normals, on layout location 1: the shader only reads xyz.
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride,
+                              (void*)offsetof(PackedVertex, normal));
+        // Texture coords, on layout location 2.
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void*)offsetof(PackedVertex, tex));
+        return;
+    }
+
+    // Specify vertex positions, on layout location 0.
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+    // Specify vertex normals, on layout location 1.
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
+    // Specify vertex texture coords, on layout location 2.
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
+}
+
+void Mesh::setPositionAttribute(VertexFormat format)
+{
+    glEnableVertexAttribArray(0);
+    if (format == VertexFormat::PACKED)
+        glVertexAttribPointer(0, 3, GL_SHORT, GL_TRUE, sizeof(PackedPosition), (void*)0);
+    else
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
 }
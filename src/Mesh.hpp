@@ -1,27 +1,126 @@
 #ifndef MESH_HPP
 #define MESH_HPP
 
+#include <cstddef>
 #include <vector>
 
+#include <glm/mat4x4.hpp>
+
+#include "Bounds.hpp"
 #include "Vertex.hpp"
 
+// How Mesh::pushToGpu() lays out and prepares mesh data.
+struct MeshUploadOptions
+{
+    // Layout of the vertex buffer.
+    VertexFormat format = VertexFormat::FLOAT32;
+    // Also store positions alone in a second, tightly packed buffer with its own VAO, so depth
+    // only passes do not fetch normals and texture coords.
+    bool position_stream = false;
+    // Reorder triangles and vertices for the vertex cache first, see optimizeMesh().
+    bool optimize = false;
+};
+
+// Where mesh generators store the meshes they create.
+enum class MeshStorage
+{
+    // CPU arrays only, uploaded later with pushToGpu().
+    CPU,
+    // Written straight into mapped GPU buffers, without any CPU copy. Needs a GL context.
+    GPU,
+    // CPU arrays, uploaded right away in the FLOAT32 format.
+    CPU_AND_GPU
+};
+
+// Buffers of a mesh mapped for writing, see Mesh::mapGpuBuffers().
+struct MappedMeshBuffers
+{
+    Vertex* vertices;
+    // 16-bit indices if `short_indices` is set, 32-bit otherwise.
+    void* indices;
+    bool short_indices;
+};
+
 // Struct containing the basic geometric information of a 3D shape:
 // A list of vertices and a list of indices representing its triangles.
+//
+// OpenGL objects are only created by pushToGpu(), and deleted with the mesh, so a mesh which was
+// never pushed needs no context. A mesh owns its objects: it can be moved but not copied, see
+// clone() for an explicit copy.
 class Mesh
 {
 public:
     Mesh();
-    Mesh(const std::vector<Vertex>& p_vertices);
-    Mesh(const std::vector<Vertex>& p_vertices,
-         const std::vector<unsigned int>& p_indices);
+    // Vertices and indices are moved in: pass temporaries, or std::move() arrays no longer needed.
+    explicit Mesh(std::vector<Vertex> p_vertices,
+                  std::vector<unsigned int> p_indices = {});
+    ~Mesh();
 
-    // Copy and append vertices and indices from another mesh.
+    Mesh(Mesh&& mesh) noexcept;
+    Mesh& operator=(Mesh&& mesh) noexcept;
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
+
+    // Copy of the vertices and indices, without any GPU data.
+    Mesh clone() const;
+
+    // Copy and append vertices and indices from another mesh. Meshes with and without indices can
+    // be mixed.
     void extend(const Mesh& mesh);
 
-    // Send data via OpenGL handles.
-    void pushToGpu();
+    // Recompute the bounds from the vertices. Done on construction and by pushToGpu(), so only
+    // needed after editing the vertices of a mesh which is not pushed again.
+    void updateBounds();
+    // Object space bounds. Meshes filled by mapGpuBuffers() are unbounded.
+    const Aabb& aabb() const;
+    const BoundingSphere& boundingSphere() const;
+
+    // Send data via OpenGL handles. Indices are stored on 16 bits when there are few enough
+    // vertices.
+    void pushToGpu(const MeshUploadOptions& options = MeshUploadOptions());
+
+    // Allocate GPU buffers for `n_vertices` vertices in the FLOAT32 format and `n_indices` indices,
+    // and map them, so generators write their data in place instead of filling the CPU arrays,
+    // which are left untouched. The mapped memory must only be written, in any order and from any
+    // thread, then unmapped with unmapGpuBuffers().
+    // If the buffers cannot be mapped, an error is printed, the pointers are null and the mesh has
+    // no GPU buffers left.
+    MappedMeshBuffers mapGpuBuffers(size_t n_vertices, size_t n_indices);
+    // Returns false if the content of the buffers was lost while they were mapped, in which case
+    // they must be mapped and filled again.
+    bool unmapGpuBuffers();
+    // Free the CPU arrays of a mesh pushed to the GPU. It is then drawn like a mesh generated with
+    // MeshStorage::GPU, but keeps its bounds.
+    void releaseCpu();
 
     void draw();
+    // Draw `instance_count` instances. Instance attributes must have been attached to the VAO,
+    // see InstanceBuffer::attach().
+    void drawInstanced(int instance_count);
+    // Draw positions only, from the position stream if there is one.
+    void drawDepth();
+    void drawDepthInstanced(int instance_count);
+
+    // Handle of the vertex array object, used to group draws of the same mesh.
+    unsigned int getId() const;
+    // Handle of the vertex array object used by depth only draws.
+    unsigned int getDepthId() const;
+
+    // Format of the vertex buffer.
+    VertexFormat vertexFormat() const;
+    // Transformation from buffer positions to object space, to apply before the model
+    // transformation. Identity unless positions are quantized.
+    const glm::mat4& dequantization() const;
+    // Size of the vertex and index buffers, in bytes.
+    size_t gpuSize() const;
+    // Number of vertices and indices in the GPU buffers.
+    size_t gpuVertexCount() const;
+    size_t gpuIndexCount() const;
+
+    // Specify the vertex attributes of a format, for the bound VAO and array buffer.
+    static void setVertexAttributes(VertexFormat format);
+    // Specify the position attribute of a position stream, for the bound VAO and array buffer.
+    static void setPositionAttribute(VertexFormat format);
 
 public:
     std::vector<Vertex> vertices;
@@ -32,6 +131,24 @@ private:
     unsigned int vao_;
     unsigned int vbo_;
     unsigned int ebo_;
+    // Position stream and its VAO, only created on demand.
+    unsigned int position_vbo_;
+    unsigned int depth_vao_;
+
+    VertexFormat format_;
+    glm::mat4 dequantization_;
+    // Type of the indices in the element buffer.
+    unsigned int index_type_;
+    // Amount of data in the GPU buffers, which may differ from the CPU arrays.
+    size_t vertex_count_;
+    size_t index_count_;
+    Aabb aabb_;
+    BoundingSphere bounding_sphere_;
+
+    // Delete the OpenGL objects, if any.
+    void releaseGpu();
+    // Draw the mesh through a VAO sharing its element buffer.
+    void drawFrom(unsigned int vao, int instance_count);
 };
 
 
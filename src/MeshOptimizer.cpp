@@ -0,0 +1,555 @@
+#include "MeshOptimizer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+
+#include <glm/glm.hpp>
+
+#include "Parallel.hpp"
+
+using namespace std;
+using glm::vec2;
+using glm::vec3;
+
+// Parameters of Forsyth's scoring, from "Linear-Speed Vertex Cache Optimisation".
+static constexpr int FORSYTH_CACHE_SIZE = 32;
+static constexpr float CACHE_DECAY_POWER = 1.5f;
+static constexpr float LAST_TRIANGLE_SCORE = 0.75f;
+static constexpr float VALENCE_BOOST_SCALE = 2.0f;
+static constexpr float VALENCE_BOOST_POWER = 0.5f;
+
+// Below this amount of vertices, welding runs on the calling thread.
+static constexpr size_t MIN_WELD_VERTICES_PER_TASK = 16384;
+
+// Score of a vertex, from its position in the simulated LRU cache (-1 if not cached) and its
+// number of triangles still to be emitted.
+static float vertexScore(int cache_position, unsigned int remaining_valence)
+{
+    if (remaining_valence == 0)
+        return -1.0f;
+
+    float score = 0.0f;
+    if (cache_position >= 0) {
+        // Vertices of the last triangle are scored equally, so the strip direction is free.
+        if (cache_position < 3) {
+            score = LAST_TRIANGLE_SCORE;
+        }
+        else {
+            const float scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+            score = pow(1.0f - (cache_position - 3) * scaler, CACHE_DECAY_POWER);
+        }
+    }
+
+    // Favour vertices with few triangles left, so they are not left behind.
+    score += VALENCE_BOOST_SCALE * pow(static_cast<float>(remaining_valence), -VALENCE_BOOST_POWER);
+    return score;
+}
+
+
+VertexCacheStats analyzeVertexCache(const vector<unsigned int>& indices,
+                                    size_t vertex_count,
+                                    int cache_size)
+{
+    assert(indices.size() % 3 == 0);
+
+    // Time stamp of the last miss of each vertex. A vertex is cached if it was loaded less than
+    // `cache_size` misses ago.
+    vector<size_t> loaded_at(vertex_count, 0);
+    vector<uint8_t> is_referenced(vertex_count, 0);
+    size_t misses = 0;
+    for (const auto index : indices) {
+        is_referenced[index] = 1;
+        if (loaded_at[index] == 0 || misses + 1 - loaded_at[index] > static_cast<size_t>(cache_size)) {
+            ++misses;
+            loaded_at[index] = misses;
+        }
+    }
+
+    const size_t n_triangles = indices.size() / 3;
+    const size_t n_referenced = count(is_referenced.begin(), is_referenced.end(), 1);
+
+    VertexCacheStats stats;
+    stats.acmr = n_triangles > 0 ? static_cast<float>(misses) / n_triangles : 0.0f;
+    stats.atvr = n_referenced > 0 ? static_cast<float>(misses) / n_referenced : 0.0f;
+    return stats;
+}
+
+void optimizeVertexCache(vector<unsigned int>& indices, size_t vertex_count)
+{
+    assert(indices.size() % 3 == 0);
+
+    const size_t n_triangles = indices.size() / 3;
+    if (n_triangles == 0)
+        return;
+
+    // Triangles of each vertex, in a single array. The first `valence[v]` entries of a vertex
+    // are its triangles not emitted yet.
+    vector<unsigned int> valence(vertex_count, 0);
+    for (const auto index : indices)
+        valence[index]++;
+
+    vector<size_t> adjacency_begin(vertex_count + 1, 0);
+    for (size_t v = 0; v < vertex_count; ++v)
+        adjacency_begin[v + 1] = adjacency_begin[v] + valence[v];
+
+    vector<unsigned int> adjacency(indices.size());
+    {
+        vector<size_t> cursor(adjacency_begin.begin(), adjacency_begin.end() - 1);
+        for (size_t t = 0; t < n_triangles; ++t) {
+            for (int k = 0; k < 3; ++k)
+                adjacency[cursor[indices[3*t + k]]++] = static_cast<unsigned int>(t);
+        }
+    }
+
+    vector<int> cache_position(vertex_count, -1);
+    vector<float> vertex_score(vertex_count);
+    for (size_t v = 0; v < vertex_count; ++v)
+        vertex_score[v] = vertexScore(-1, valence[v]);
+
+    vector<float> triangle_score(n_triangles);
+    vector<uint8_t> is_emitted(n_triangles, 0);
+    for (size_t t = 0; t < n_triangles; ++t) {
+        triangle_score[t] = vertex_score[indices[3*t]]
+                          + vertex_score[indices[3*t + 1]]
+                          + vertex_score[indices[3*t + 2]];
+    }
+
+    // Simulated LRU cache, with room for the vertices pushed out by one triangle.
+    vector<unsigned int> cache;
+    vector<unsigned int> new_cache;
+    cache.reserve(FORSYTH_CACHE_SIZE + 3);
+    new_cache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+    vector<unsigned int> optimized;
+    optimized.reserve(indices.size());
+
+    size_t best = max_element(triangle_score.begin(), triangle_score.end()) - triangle_score.begin();
+    // Triangles before this one are all emitted, for the fallback scan.
+    size_t scan_cursor = 0;
+
+    for (size_t n_emitted = 0; n_emitted < n_triangles; ++n_emitted) {
+        const unsigned int* tri = &indices[3*best];
+        optimized.insert(optimized.end(), tri, tri + 3);
+        is_emitted[best] = 1;
+
+        // Remove the triangle from the pending triangles of its vertices.
+        for (int k = 0; k < 3; ++k) {
+            const unsigned int v = tri[k];
+            unsigned int* begin = &adjacency[adjacency_begin[v]];
+            unsigned int* end = begin + valence[v];
+            *find(begin, end, static_cast<unsigned int>(best)) = *(end - 1);
+            valence[v]--;
+        }
+
+        // Move its vertices to the front of the cache.
+        new_cache.assign(tri, tri + 3);
+        for (const auto v : cache) {
+            if (v != tri[0] && v != tri[1] && v != tri[2])
+                new_cache.push_back(v);
+        }
+        cache.swap(new_cache);
+
+        // Update scores of cached vertices and of the vertices pushed out of the cache, then of
+        // their pending triangles, and pick the best of those.
+        for (size_t i = 0; i < cache.size(); ++i) {
+            const unsigned int v = cache[i];
+            cache_position[v] = i < FORSYTH_CACHE_SIZE ? static_cast<int>(i) : -1;
+            vertex_score[v] = vertexScore(cache_position[v], valence[v]);
+        }
+
+        float best_score = -1.0f;
+        for (const auto v : cache) {
+            for (size_t i = 0; i < valence[v]; ++i) {
+                const unsigned int t = adjacency[adjacency_begin[v] + i];
+                const float score = vertex_score[indices[3*t]]
+                                  + vertex_score[indices[3*t + 1]]
+                                  + vertex_score[indices[3*t + 2]];
+                triangle_score[t] = score;
+                if (score > best_score) {
+                    best_score = score;
+                    best = t;
+                }
+            }
+        }
+
+        if (cache.size() > FORSYTH_CACHE_SIZE)
+            cache.resize(FORSYTH_CACHE_SIZE);
+
+        // No pending triangle touches the cache: restart from any pending triangle.
+        if (best_score < 0.0f) {
+            while (scan_cursor < n_triangles && is_emitted[scan_cursor])
+                ++scan_cursor;
+            best = scan_cursor;
+        }
+    }
+
+    indices.swap(optimized);
+}
+
+void optimizeOverdraw(vector<unsigned int>& indices, const vector<Vertex>& vertices, int cache_size)
+{
+    assert(indices.size() % 3 == 0);
+
+    const size_t n_triangles = indices.size() / 3;
+    if (n_triangles == 0)
+        return;
+
+    // Split the triangle list where a triangle misses the cache for all of its vertices: such a
+    // triangle starts a new strip anyway, so reordering clusters keeps the cache efficiency.
+    vector<size_t> cluster_begin;
+    {
+        vector<size_t> loaded_at(vertices.size(), 0);
+        size_t misses = 0;
+        for (size_t t = 0; t < n_triangles; ++t) {
+            int triangle_misses = 0;
+            for (int k = 0; k < 3; ++k) {
+                const unsigned int v = indices[3*t + k];
+                if (loaded_at[v] == 0 || misses + 1 - loaded_at[v] > static_cast<size_t>(cache_size)) {
+                    ++misses;
+                    loaded_at[v] = misses;
+                    ++triangle_misses;
+                }
+            }
+            if (triangle_misses == 3)
+                cluster_begin.push_back(t);
+        }
+        cluster_begin.push_back(n_triangles);
+    }
+
+    const size_t n_clusters = cluster_begin.size() - 1;
+    if (n_clusters < 2)
+        return;
+
+    // Mesh centroid, weighted by triangle area.
+    vector<vec3> cluster_centroid(n_clusters, vec3(0.0f));
+    vector<vec3> cluster_normal(n_clusters, vec3(0.0f));
+    vector<float> cluster_area(n_clusters, 0.0f);
+    vec3 mesh_centroid(0.0f);
+    float mesh_area = 0.0f;
+    for (size_t c = 0; c < n_clusters; ++c) {
+        for (size_t t = cluster_begin[c]; t < cluster_begin[c + 1]; ++t) {
+            const vec3& a = vertices[indices[3*t]].pos;
+            const vec3& b = vertices[indices[3*t + 1]].pos;
+            const vec3& d = vertices[indices[3*t + 2]].pos;
+            // Twice the area, oriented by the triangle winding.
+            const vec3 normal = glm::cross(b - a, d - a);
+            const float area = glm::length(normal);
+
+            cluster_centroid[c] += area * (a + b + d) / 3.0f;
+            cluster_normal[c] += normal;
+            cluster_area[c] += area;
+        }
+        mesh_centroid += cluster_centroid[c];
+        mesh_area += cluster_area[c];
+    }
+    if (mesh_area > 0.0f)
+        mesh_centroid /= mesh_area;
+
+    // Clusters farther out along their own normal are more likely to occlude the rest.
+    vector<float> sort_key(n_clusters, 0.0f);
+    for (size_t c = 0; c < n_clusters; ++c) {
+        if (cluster_area[c] <= 0.0f)
+            continue;
+        const vec3 centroid = cluster_centroid[c] / cluster_area[c];
+        const float normal_length = glm::length(cluster_normal[c]);
+        if (normal_length > 0.0f)
+            sort_key[c] = glm::dot(centroid - mesh_centroid, cluster_normal[c] / normal_length);
+    }
+
+    vector<size_t> order(n_clusters);
+    for (size_t c = 0; c < n_clusters; ++c)
+        order[c] = c;
+    stable_sort(order.begin(), order.end(),
+                [&](size_t a, size_t b) { return sort_key[a] > sort_key[b]; });
+
+    vector<unsigned int> sorted;
+    sorted.reserve(indices.size());
+    for (const auto c : order)
+        sorted.insert(sorted.end(), &indices[3*cluster_begin[c]], &indices[3*cluster_begin[c + 1]]);
+    indices.swap(sorted);
+}
+
+void optimizeVertexFetch(vector<Vertex>& vertices, vector<unsigned int>& indices)
+{
+    const unsigned int unassigned = static_cast<unsigned int>(-1);
+
+    vector<unsigned int> new_index(vertices.size(), unassigned);
+    unsigned int next = 0;
+    for (auto& index : indices) {
+        if (new_index[index] == unassigned)
+            new_index[index] = next++;
+        index = new_index[index];
+    }
+    for (auto& index : new_index) {
+        if (index == unassigned)
+            index = next++;
+    }
+
+    vector<Vertex> reordered(vertices.size());
+    for (size_t v = 0; v < vertices.size(); ++v)
+        reordered[new_index[v]] = vertices[v];
+    vertices.swap(reordered);
+}
+
+void optimizeMesh(Mesh& mesh)
+{
+    if (mesh.indices.empty())
+        return;
+
+    optimizeVertexCache(mesh.indices, mesh.vertices.size());
+    optimizeOverdraw(mesh.indices, mesh.vertices);
+    optimizeVertexFetch(mesh.vertices, mesh.indices);
+}
+
+using WeldCell = array<int64_t, 3>;
+
+// Hash of a welding grid cell. Collisions only cost extra comparisons.
+static uint64_t hashCell(int64_t x, int64_t y, int64_t z)
+{
+    return static_cast<uint64_t>(x) * 0x9E3779B97F4A7C15ull
+         ^ static_cast<uint64_t>(y) * 0xC2B2AE3D27D4EB4Full
+         ^ static_cast<uint64_t>(z) * 0x165667B19E3779F9ull;
+}
+
+static bool isNear(const vec2& a, const vec2& b, float tolerance)
+{
+    return abs(a.x - b.x) <= tolerance && abs(a.y - b.y) <= tolerance;
+}
+
+static bool isNear(const vec3& a, const vec3& b, float tolerance)
+{
+    return abs(a.x - b.x) <= tolerance && abs(a.y - b.y) <= tolerance && abs(a.z - b.z) <= tolerance;
+}
+
+// Whether a normal can be normalized: finite and not zero.
+static bool isValidNormal(const vec3& normal)
+{
+    return isfinite(normal.x) && isfinite(normal.y) && isfinite(normal.z) && glm::dot(normal, normal) > 0.0f;
+}
+
+void weldVertices(Mesh& mesh, const WeldOptions& options)
+{
+    assert(options.position_tolerance > 0.0f);
+
+    auto& vertices = mesh.vertices;
+    auto& indices = mesh.indices;
+    const size_t n_vertices = vertices.size();
+    if (n_vertices == 0)
+        return;
+
+    if (indices.empty()) {
+        indices.resize(n_vertices);
+        for (size_t v = 0; v < n_vertices; ++v)
+            indices[v] = static_cast<unsigned int>(v);
+    }
+
+    // Cells are twice the tolerance wide, so the positions near a vertex are in at most two cells
+    // along each axis. Vertices are sorted by cell hash, and a hash table gives the range of each
+    // cell in that order.
+    const float tolerance = options.position_tolerance;
+    const float inv_cell_size = 0.5f / tolerance;
+    auto cellOf = [inv_cell_size](const vec3& pos) {
+        const vec3 cell = glm::floor(pos * inv_cell_size);
+        return WeldCell{static_cast<int64_t>(cell.x), static_cast<int64_t>(cell.y), static_cast<int64_t>(cell.z)};
+    };
+
+    vector<pair<uint64_t, unsigned int>> by_cell(n_vertices);
+    parallelFor(0, n_vertices, MIN_WELD_VERTICES_PER_TASK, [&](size_t begin, size_t end) {
+        for (size_t v = begin; v < end; ++v) {
+            const WeldCell cell = cellOf(vertices[v].pos);
+            by_cell[v] = {hashCell(cell[0], cell[1], cell[2]), static_cast<unsigned int>(v)};
+        }
+    });
+    sort(by_cell.begin(), by_cell.end());
+
+    // Open addressing with linear probing. Empty entries have an empty range.
+    struct CellRange
+    {
+        uint64_t hash;
+        unsigned int begin;
+        unsigned int end;
+    };
+    size_t table_size = 1;
+    while (table_size < 2 * n_vertices)
+        table_size *= 2;
+    const size_t table_mask = table_size - 1;
+    vector<CellRange> cell_ranges(table_size, CellRange{0, 0, 0});
+    for (size_t begin = 0, end = 0; begin < n_vertices; begin = end) {
+        const uint64_t hash = by_cell[begin].first;
+        for (end = begin + 1; end < n_vertices && by_cell[end].first == hash; ++end) {}
+
+        size_t entry = hash & table_mask;
+        while (cell_ranges[entry].end != 0)
+            entry = (entry + 1) & table_mask;
+        cell_ranges[entry] = {hash, static_cast<unsigned int>(begin), static_cast<unsigned int>(end)};
+    }
+
+    // Link every vertex to the first vertex it merges with, and to the first vertex at its
+    // position. Both are the vertex itself if there is none.
+    const float max_distance2 = tolerance * tolerance;
+    vector<unsigned int> merged_with(n_vertices);
+    vector<unsigned int> same_position(n_vertices);
+    parallelFor(0, n_vertices, MIN_WELD_VERTICES_PER_TASK, [&](size_t begin, size_t end) {
+        for (size_t v = begin; v < end; ++v) {
+            const Vertex& vertex = vertices[v];
+            const WeldCell low = cellOf(vertex.pos - vec3(tolerance));
+            const WeldCell high = cellOf(vertex.pos + vec3(tolerance));
+            auto merged = static_cast<unsigned int>(v);
+            auto positioned = static_cast<unsigned int>(v);
+
+            for (int64_t x = low[0]; x <= high[0]; ++x)
+            for (int64_t y = low[1]; y <= high[1]; ++y)
+            for (int64_t z = low[2]; z <= high[2]; ++z) {
+                const uint64_t hash = hashCell(x, y, z);
+                size_t entry = hash & table_mask;
+                while (cell_ranges[entry].end != 0 && cell_ranges[entry].hash != hash)
+                    entry = (entry + 1) & table_mask;
+
+                // Vertices of a cell are sorted by index, so only earlier vertices are visited.
+                for (unsigned int i = cell_ranges[entry].begin;
+                     i < cell_ranges[entry].end && by_cell[i].second < v; ++i) {
+                    const unsigned int other_index = by_cell[i].second;
+                    const Vertex& other = vertices[other_index];
+                    const vec3 offset = other.pos - vertex.pos;
+                    if (glm::dot(offset, offset) > max_distance2)
+                        continue;
+
+                    positioned = min(positioned, other_index);
+                    if (other_index < merged
+                        && isNear(other.tex, vertex.tex, options.attribute_tolerance)
+                        && isNear(other.normal, vertex.normal, options.attribute_tolerance))
+                        merged = other_index;
+                }
+            }
+
+            merged_with[v] = merged;
+            same_position[v] = positioned;
+        }
+    });
+
+    // Links always point to earlier vertices, so a single pass resolves chains to their root.
+    for (size_t v = 0; v < n_vertices; ++v) {
+        merged_with[v] = merged_with[merged_with[v]];
+        same_position[v] = same_position[same_position[v]];
+    }
+
+    if (options.mode == WeldMode::POSITION) {
+        // Vertices at each position, listed after each other in index order, starting at the
+        // first vertex of the position.
+        vector<unsigned int> group_begin(n_vertices + 1, 0);
+        for (size_t v = 0; v < n_vertices; ++v)
+            ++group_begin[same_position[v] + 1];
+        for (size_t v = 0; v < n_vertices; ++v)
+            group_begin[v + 1] += group_begin[v];
+        vector<unsigned int> group_members(n_vertices);
+        vector<unsigned int> group_end(group_begin.begin(), group_begin.end() - 1);
+        for (size_t v = 0; v < n_vertices; ++v)
+            group_members[group_end[same_position[v]]++] = static_cast<unsigned int>(v);
+
+        // Average the normals within the crease angle of each vertex. Degenerate samples, e.g. at
+        // the poles of a patch, have no normal of their own and take the average of the others.
+        const float min_cosine = cos(options.crease_angle);
+        vector<vec3> normals(n_vertices, vec3(0.0f));
+        parallelFor(0, n_vertices, MIN_WELD_VERTICES_PER_TASK, [&](size_t begin, size_t end) {
+            vector<vec3> unit_normals;
+            for (size_t root = begin; root < end; ++root) {
+                const unsigned int* members = &group_members[group_begin[root]];
+                const size_t n_members = group_begin[root + 1] - group_begin[root];
+                unit_normals.assign(n_members, vec3(0.0f));
+                for (size_t m = 0; m < n_members; ++m) {
+                    if (isValidNormal(vertices[members[m]].normal))
+                        unit_normals[m] = glm::normalize(vertices[members[m]].normal);
+                }
+
+                for (size_t m = 0; m < n_members; ++m) {
+                    const bool has_normal = glm::dot(unit_normals[m], unit_normals[m]) > 0.0f;
+                    vec3 sum(0.0f);
+                    for (size_t other = 0; other < n_members; ++other) {
+                        if (glm::dot(unit_normals[other], unit_normals[other]) > 0.0f
+                            && (!has_normal || glm::dot(unit_normals[other], unit_normals[m]) >= min_cosine))
+                            sum += vertices[members[other]].normal;
+                    }
+                    if (glm::dot(sum, sum) > 0.0f)
+                        normals[members[m]] = glm::normalize(sum);
+                }
+            }
+        });
+
+        // Positions where no vertex has a normal take the average normal of their neighbors.
+        vector<vec3> neighbor_sums(n_vertices, vec3(0.0f));
+        if (indices.size() % 3 == 0) {
+            for (size_t i = 0; i < indices.size(); i += 3) {
+                for (size_t corner = 0; corner < 3; ++corner) {
+                    const unsigned int v = indices[i + corner];
+                    if (isValidNormal(normals[v]))
+                        continue;
+                    for (size_t other = 1; other < 3; ++other)
+                        neighbor_sums[same_position[v]] += normals[indices[i + (corner + other) % 3]];
+                }
+            }
+        }
+        for (size_t v = 0; v < n_vertices; ++v) {
+            const vec3& sum = neighbor_sums[same_position[v]];
+            if (!isValidNormal(normals[v]) && isValidNormal(sum))
+                normals[v] = glm::normalize(sum);
+        }
+
+        // Merge the vertices at a position that ended up with the same normal and texture
+        // coordinates. The first vertex of the position keeps its own position for all of them.
+        for (size_t v = 0; v < n_vertices; ++v) {
+            const unsigned int root = same_position[v];
+            vertices[v].pos = vertices[root].pos;
+            vertices[v].normal = normals[v];
+
+            merged_with[v] = static_cast<unsigned int>(v);
+            for (unsigned int m = group_begin[root]; group_members[m] < v; ++m) {
+                const unsigned int other = group_members[m];
+                if (merged_with[other] == other
+                    && isNear(vertices[other].tex, vertices[v].tex, options.attribute_tolerance)
+                    && isNear(vertices[other].normal, vertices[v].normal, options.attribute_tolerance)) {
+                    merged_with[v] = other;
+                    break;
+                }
+            }
+        }
+    }
+
+    // Keep the roots only, in their original order.
+    vector<unsigned int> new_index(n_vertices);
+    vector<Vertex> welded;
+    for (size_t v = 0; v < n_vertices; ++v) {
+        if (merged_with[v] == v) {
+            new_index[v] = static_cast<unsigned int>(welded.size());
+            welded.push_back(vertices[v]);
+        }
+        else {
+            new_index[v] = new_index[merged_with[v]];
+        }
+    }
+    vertices.swap(welded);
+
+    parallelFor(0, indices.size(), MIN_WELD_VERTICES_PER_TASK, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+            indices[i] = new_index[indices[i]];
+    });
+
+    // Drop the triangles collapsed by the merge.
+    if (indices.size() % 3 == 0) {
+        size_t n_kept = 0;
+        for (size_t i = 0; i < indices.size(); i += 3) {
+            const unsigned int a = indices[i];
+            const unsigned int b = indices[i + 1];
+            const unsigned int c = indices[i + 2];
+            if (a == b || b == c || c == a)
+                continue;
+            indices[n_kept++] = a;
+            indices[n_kept++] = b;
+            indices[n_kept++] = c;
+        }
+        indices.resize(n_kept);
+    }
+}
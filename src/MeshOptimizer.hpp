@@ -0,0 +1,69 @@
+#ifndef MESH_OPTIMIZER_HPP
+#define MESH_OPTIMIZER_HPP
+
+#include <cstddef>
+#include <vector>
+
+#include "Mesh.hpp"
+
+// Efficiency of an index list for a FIFO post-transform vertex cache.
+struct VertexCacheStats
+{
+    // Average cache miss ratio: transformed vertices per triangle. 0.5 at best, 3 at worst.
+    float acmr;
+    // Average transform to vertex ratio: transformed vertices per referenced vertex. 1 at best.
+    float atvr;
+};
+
+// Simulate a FIFO vertex cache of `cache_size` entries over a triangle list.
+VertexCacheStats analyzeVertexCache(const std::vector<unsigned int>& indices,
+                                    size_t vertex_count,
+                                    int cache_size = 16);
+
+// Reorder triangles so that consecutive triangles share vertices, using Forsyth's linear-speed
+// vertex cache optimization.
+void optimizeVertexCache(std::vector<unsigned int>& indices, size_t vertex_count);
+
+// Reorder clusters of triangles so that outer, front facing parts of the mesh tend to be drawn
+// first. Clusters start wherever the cache-optimized order has a triangle with no cached vertex,
+// so the vertex cache efficiency is kept.
+void optimizeOverdraw(std::vector<unsigned int>& indices,
+                      const std::vector<Vertex>& vertices,
+                      int cache_size = 16);
+
+// Reorder vertices by first use in the index list, so vertex fetches are mostly sequential.
+// Unreferenced vertices are moved to the end.
+void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+
+// Run all of the above on an indexed mesh. Meshes without indices are left unchanged.
+void optimizeMesh(Mesh& mesh);
+
+// Which vertices weldVertices() merges.
+enum class WeldMode
+{
+    // Vertices whose position, normal and texture coordinates all match.
+    ALL_ATTRIBUTES,
+    // Vertices whose position and texture coordinates match. Normals at a position are averaged
+    // within the crease angle, so shading is smooth across patch seams but hard edges are kept.
+    // Vertices at one position with different normals or texture coordinates stay apart, with a
+    // bit-identical position.
+    POSITION
+};
+
+struct WeldOptions
+{
+    WeldMode mode = WeldMode::ALL_ATTRIBUTES;
+    // Largest distance between two positions considered equal.
+    float position_tolerance = 1e-5f;
+    // Largest difference between two normal or texture coordinate components considered equal.
+    float attribute_tolerance = 1e-4f;
+    // Largest angle in radians between two normals averaged in POSITION mode. 30 degrees by default.
+    float crease_angle = 0.5235988f;
+};
+
+// Merge duplicate vertices and remap the indices accordingly. Candidates are found with a spatial
+// hash on a grid of `position_tolerance` cells, in parallel for large meshes. A mesh without
+// indices gets one.
+void weldVertices(Mesh& mesh, const WeldOptions& options = WeldOptions());
+
+#endif // MESH_OPTIMIZER_HPP
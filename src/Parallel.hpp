@@ -0,0 +1,42 @@
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// Split the range [begin, end) in contiguous chunks and process them concurrently.
+// `func(chunk_begin, chunk_end)` is called once per chunk. Chunks are never smaller than
+// `min_chunk_size`, so small ranges are processed on the calling thread without spawning anything.
+template <typename Func>
+void parallelFor(size_t begin, size_t end, size_t min_chunk_size, Func&& func)
+{
+    if (begin >= end)
+        return;
+
+    const size_t count = end - begin;
+    const size_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+    const size_t n_chunks = std::min(max_threads, std::max<size_t>(1, count / std::max<size_t>(1, min_chunk_size)));
+
+    if (n_chunks == 1) {
+        func(begin, end);
+        return;
+    }
+
+    const size_t chunk_size = (count + n_chunks - 1) / n_chunks;
+    std::vector<std::thread> workers;
+    workers.reserve(n_chunks - 1);
+
+    // Spawn workers for every chunk but the first, which runs on the calling thread.
+    for (size_t chunk_begin = begin + chunk_size; chunk_begin < end; chunk_begin += chunk_size) {
+        const size_t chunk_end = std::min(end, chunk_begin + chunk_size);
+        workers.emplace_back([&func, chunk_begin, chunk_end]() { func(chunk_begin, chunk_end); });
+    }
+    func(begin, std::min(end, begin + chunk_size));
+
+    for (auto& worker : workers)
+        worker.join();
+}
+
+#endif // PARALLEL_HPP
@@ -0,0 +1,112 @@
+#include "PatchMesh.hpp"
+
+#include <cassert>
+#include <cstdint>
+#include <utility>
+
+#include <glad/glad.h>
+
+#include "GlState.hpp"
+
+using namespace std;
+using glm::vec3;
+
+PatchMesh::PatchMesh(int vertices_per_patch):
+    vao_{0}, vbo_{0}, ebo_{0},
+    vertices_per_patch_(vertices_per_patch)
+{
+    assert(vertices_per_patch > 0);
+}
+
+PatchMesh::~PatchMesh()
+{
+    releaseGpu();
+}
+
+PatchMesh::PatchMesh(PatchMesh&& mesh) noexcept:
+    control_points(move(mesh.control_points)),
+    indices(move(mesh.indices)),
+    vao_(mesh.vao_), vbo_(mesh.vbo_), ebo_(mesh.ebo_),
+    vertices_per_patch_(mesh.vertices_per_patch_)
+{
+    mesh.vao_ = mesh.vbo_ = mesh.ebo_ = 0;
+}
+
+PatchMesh& PatchMesh::operator=(PatchMesh&& mesh) noexcept
+{
+    if (this == &mesh)
+        return *this;
+
+    releaseGpu();
+    control_points = move(mesh.control_points);
+    indices = move(mesh.indices);
+    vao_ = mesh.vao_;
+    vbo_ = mesh.vbo_;
+    ebo_ = mesh.ebo_;
+    vertices_per_patch_ = mesh.vertices_per_patch_;
+
+    mesh.vao_ = mesh.vbo_ = mesh.ebo_ = 0;
+    return *this;
+}
+
+void PatchMesh::pushToGpu()
+{
+    assert(!control_points.empty());
+    assert(indices.size() % vertices_per_patch_ == 0);
+    assert(control_points.size() <= UINT16_MAX + 1);
+
+    // Create OpenGL objects on the first upload.
+    if (vao_ == 0) {
+        glGenVertexArrays(1, &vao_);
+        glGenBuffers(1, &vbo_);
+        glGenBuffers(1, &ebo_);
+    }
+
+    GlState::bindVertexArray(vao_);
+
+    glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+    glBufferData(GL_ARRAY_BUFFER,
+                 control_points.size() * sizeof(vec3),
+                 control_points.data(),
+                 GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(vec3), (void*)0);
+
+    const vector<uint16_t> short_indices(indices.begin(), indices.end());
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                 short_indices.size() * sizeof(uint16_t),
+                 short_indices.data(),
+                 GL_STATIC_DRAW);
+}
+
+void PatchMesh::releaseGpu()
+{
+    if (vao_ != 0)
+        GlState::deleteVertexArray(vao_);
+
+    const unsigned int buffers[] = {vbo_, ebo_};
+    for (const unsigned int buffer : buffers) {
+        if (buffer != 0)
+            glDeleteBuffers(1, &buffer);
+    }
+
+    vao_ = vbo_ = ebo_ = 0;
+}
+
+void PatchMesh::draw() const
+{
+    GlState::bindVertexArray(vao_);
+    glPatchParameteri(GL_PATCH_VERTICES, vertices_per_patch_);
+    glDrawElements(GL_PATCHES, indices.size(), GL_UNSIGNED_SHORT, (void*)0);
+}
+
+unsigned int PatchMesh::getId() const
+{
+    return vao_;
+}
+
+size_t PatchMesh::gpuSize() const
+{
+    return control_points.size() * sizeof(vec3) + indices.size() * sizeof(uint16_t);
+}
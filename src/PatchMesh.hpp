@@ -0,0 +1,50 @@
+#ifndef PATCH_MESH_HPP
+#define PATCH_MESH_HPP
+
+#include <cstddef>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+// Control points of surface patches, drawn as GL_PATCHES and evaluated on the GPU by
+// tessellation shaders, so only the control points are stored instead of a sampled mesh.
+class PatchMesh
+{
+public:
+    explicit PatchMesh(int vertices_per_patch);
+    ~PatchMesh();
+
+    PatchMesh(PatchMesh&& mesh) noexcept;
+    PatchMesh& operator=(PatchMesh&& mesh) noexcept;
+    PatchMesh(const PatchMesh&) = delete;
+    PatchMesh& operator=(const PatchMesh&) = delete;
+
+    // Send control points and patch indices via OpenGL handles, indices on 16 bits.
+    // The OpenGL objects are created on the first call.
+    void pushToGpu();
+    // Delete the OpenGL objects, if any.
+    void releaseGpu();
+
+    // Draw every patch. The bound program must have tessellation stages.
+    void draw() const;
+
+    // Handle of the vertex array object.
+    unsigned int getId() const;
+    // Size of the control point and index buffers, in bytes.
+    size_t gpuSize() const;
+
+public:
+    std::vector<glm::vec3> control_points;
+    // Control points of each patch, `vertices_per_patch` at a time.
+    std::vector<unsigned int> indices;
+
+private:
+    // Handles to OpenGL objects.
+    unsigned int vao_;
+    unsigned int vbo_;
+    unsigned int ebo_;
+
+    int vertices_per_patch_;
+};
+
+#endif // PATCH_MESH_HPP
@@ -0,0 +1,95 @@
+#include "RenderQueue.hpp"
+
+#include <algorithm>
+
+using namespace std;
+
+// Width and position of each field of the sort key.
+static constexpr int DEPTH_BITS = 16;
+static constexpr int MESH_BITS = 12;
+static constexpr int MATERIAL_BITS = 12;
+static constexpr int TEXTURE_BITS = 12;
+static constexpr int PROGRAM_BITS = 8;
+static constexpr int PASS_BITS = 4;
+
+static constexpr int DEPTH_SHIFT = 0;
+static constexpr int MESH_SHIFT = DEPTH_SHIFT + DEPTH_BITS;
+static constexpr int MATERIAL_SHIFT = MESH_SHIFT + MESH_BITS;
+static constexpr int TEXTURE_SHIFT = MATERIAL_SHIFT + MATERIAL_BITS;
+static constexpr int PROGRAM_SHIFT = TEXTURE_SHIFT + TEXTURE_BITS;
+static constexpr int PASS_SHIFT = PROGRAM_SHIFT + PROGRAM_BITS;
+static_assert(PASS_SHIFT + PASS_BITS == 64, "Sort key fields must fill 64 bits");
+
+// Truncate `value` to `bits` bits and move it to its field.
+static uint64_t field(uint64_t value, int bits, int shift)
+{
+    return (value & ((uint64_t(1) << bits) - 1)) << shift;
+}
+
+
+int RenderStats::stateChanges() const
+{
+    return program_changes + texture_changes + material_changes + mesh_changes;
+}
+
+uint64_t RenderQueue::makeSortKey(unsigned int pass,
+                                  unsigned int program,
+                                  unsigned int texture,
+                                  unsigned int material,
+                                  unsigned int mesh,
+                                  float depth)
+{
+    const float max_depth = static_cast<float>((1 << DEPTH_BITS) - 1);
+    const auto quantized_depth = static_cast<uint64_t>(clamp(depth, 0.0f, 1.0f) * max_depth);
+
+    return field(pass, PASS_BITS, PASS_SHIFT)
+         | field(program, PROGRAM_BITS, PROGRAM_SHIFT)
+         | field(texture, TEXTURE_BITS, TEXTURE_SHIFT)
+         | field(material, MATERIAL_BITS, MATERIAL_SHIFT)
+         | field(mesh, MESH_BITS, MESH_SHIFT)
+         | field(quantized_depth, DEPTH_BITS, DEPTH_SHIFT);
+}
+
+unsigned int RenderQueue::keyPass(uint64_t key)
+{
+    return static_cast<unsigned int>(key >> PASS_SHIFT);
+}
+
+void RenderQueue::clear()
+{
+    items_.clear();
+}
+
+void RenderQueue::push(const DrawItem& item)
+{
+    items_.push_back(item);
+}
+
+void RenderQueue::sort()
+{
+    sorted_.resize(items_.size());
+
+    // One counting sort per key byte, least significant first. Each pass is stable, so the
+    // order established by the lower bytes is kept.
+    for (int shift = 0; shift < 64; shift += 8) {
+        size_t offsets[257] = {};
+        for (const auto& item : items_)
+            offsets[((item.key >> shift) & 0xFF) + 1]++;
+
+        // Skip bytes shared by every key, they do not change the order.
+        if (any_of(begin(offsets) + 1, end(offsets), [&](size_t n) { return n == items_.size(); }))
+            continue;
+
+        for (int byte = 0; byte < 256; ++byte)
+            offsets[byte + 1] += offsets[byte];
+        for (const auto& item : items_)
+            sorted_[offsets[(item.key >> shift) & 0xFF]++] = item;
+
+        items_.swap(sorted_);
+    }
+}
+
+const vector<DrawItem>& RenderQueue::items() const
+{
+    return items_;
+}
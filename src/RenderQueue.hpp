@@ -0,0 +1,82 @@
+#ifndef RENDER_QUEUE_HPP
+#define RENDER_QUEUE_HPP
+
+#include <cstdint>
+#include <vector>
+
+class Mesh;
+class ShaderProgram;
+class Texture;
+struct SceneNode;
+
+// A single draw, as collected by the scene traversal.
+struct DrawItem
+{
+    // Sort key, see RenderQueue::makeSortKey().
+    uint64_t key;
+
+    SceneNode* node;
+    Mesh* mesh;
+    const ShaderProgram* program;
+    // May be null for programs which do not sample a texture.
+    const Texture* texture;
+    int material;
+};
+
+// Per frame rendering counters.
+struct RenderStats
+{
+    int draws = 0;
+    int program_changes = 0;
+    int texture_changes = 0;
+    int material_changes = 0;
+    int mesh_changes = 0;
+    // Draws skipped because their bounds are outside the frustum of their pass.
+    int culled_draws = 0;
+    // Times the CPU waited for the GPU to release the region of the stream buffer.
+    int stream_stalls = 0;
+
+    // Total number of state changes.
+    int stateChanges() const;
+};
+
+// List of draws, sorted to minimize state changes on submission.
+//
+// The 64-bit sort key holds, from most to least significant bits:
+// | pass (4) | program (8) | texture (12) | material (12) | mesh (12) | depth (16) |
+// so draws are grouped by pass first, then by the most expensive state to change, and drawn
+// front to back within a group.
+class RenderQueue
+{
+public:
+
+    RenderQueue() = default;
+
+    // Build a sort key. Ids are truncated to the width of their field: two objects sharing an id
+    // only end up less well grouped. `depth` is the normalized distance to the viewer, in [0, 1].
+    static uint64_t makeSortKey(unsigned int pass,
+                                unsigned int program,
+                                unsigned int texture,
+                                unsigned int material,
+                                unsigned int mesh,
+                                float depth);
+
+    // Pass encoded in a sort key.
+    static unsigned int keyPass(uint64_t key);
+
+    void clear();
+    void push(const DrawItem& item);
+
+    // Sort draws by key, with a LSD radix sort.
+    void sort();
+
+    const std::vector<DrawItem>& items() const;
+
+private:
+
+    std::vector<DrawItem> items_;
+    // Scratch buffer for sorting.
+    std::vector<DrawItem> sorted_;
+};
+
+#endif // RENDER_QUEUE_HPP
@@ -1,15 +1,86 @@
 #include "Renderer.hpp"
 
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
 #include <iostream>
 
 #include <glad/glad.h>
-#include <glm/vec3.hpp>
+#include <glm/glm.hpp>
 
 #include "Camera.hpp"
+#include "GeometryArena.hpp"
+#include "GlState.hpp"
 #include "Scene.hpp"
 
 using namespace std;
 using glm::vec3;
+using glm::mat3;
+using glm::mat4;
+
+// Binding points of the uniform blocks.
+static const unsigned int FRAME_DATA_BINDING = 0;
+static const unsigned int MATERIALS_BINDING = 1;
+
+// Texture units of the Phong program samplers.
+static const int SHADOW_MAP_SLOT = 0;
+static const int OBJECT_TEXTURE_SLOT = 1;
+
+// Smallest batch drawn instanced. Single draws keep using per object uniforms.
+static const size_t MIN_INSTANCES = 2;
+
+// Shader variant reading transforms from the instance buffer.
+static const char* INSTANCED_DEFINES = "#define INSTANCED\n";
+// Tessellated shader variant only computing the light space position.
+static const char* DEPTH_ONLY_DEFINES = "#define DEPTH_ONLY\n";
+
+// Initial capacity of the stream buffer per frame, grown if a frame needs more.
+static const size_t INITIAL_STREAM_CAPACITY = 1 << 20;
+
+// Distance to the viewer mapped to the largest depth of the sort keys.
+static const float MAX_SORT_DEPTH = 100.0f;
+
+// CPU mirror of the FrameData uniform block, following the std140 layout rules.
+struct FrameData
+{
+    mat4 view;
+    mat4 projection;
+    mat4 light_view;
+    mat4 light_projection;
+    vec3 light_position;
+    float ambient_coef;
+    float diffuse_coef;
+    float specular_coef;
+};
+static_assert(offsetof(FrameData, light_position) == 256, "FrameData must follow std140");
+static_assert(offsetof(FrameData, ambient_coef) == 268, "FrameData must follow std140");
+static_assert(offsetof(FrameData, specular_coef) == 276, "FrameData must follow std140");
+
+// Model matrix of a draw. Quantized mesh positions are mapped back to object space first, so the
+// normal matrix of the node is left unchanged.
+static mat4 modelMatrix(const DrawItem& item)
+{
+    return item.node->worldTransformation() * item.mesh->dequantization();
+}
+
+// Set the model, model-view and normal matrices of a draw, computed once per object rather than
+// once per vertex.
+static void setModelUniforms(const PhongUniformLocations& locations, const mat4& view, const DrawItem& item)
+{
+    SceneNode* node = item.node;
+    const mat4 model = modelMatrix(item);
+    ShaderProgram::setUniformMat4f(locations.model, model);
+    ShaderProgram::setUniformMat4f(locations.model_view, view * model);
+    // The view transformation is a rigid motion, so its normal matrix is its own 3x3 block.
+    ShaderProgram::setUniformMat3f(locations.normal_matrix, mat3(view) * node->worldNormalMatrix());
+}
+
+// Normalized distance between a node and a viewer, for sort keys.
+static float sortDepth(SceneNode* node, const Camera& viewer)
+{
+    const vec3 node_position = vec3(node->worldTransformation()[3]);
+    return glm::length(node_position - viewer.position()) / MAX_SORT_DEPTH;
+}
 
 TableSceneRenderer::TableSceneRenderer(int screen_width, int screen_height):
     shader_phong_("../src/shader/Phong.vert",
@@ -20,6 +91,32 @@ TableSceneRenderer::TableSceneRenderer(int screen_width, int screen_height):
                    "../src/shader/Shadow.frag"),
     shader_shadow_debug_("../src/shader/Debug.vert",
                          "../src/shader/Debug.frag"),
+    shader_phong_instanced_("../src/shader/Phong.vert",
+                            "../src/shader/Phong.frag",
+                            INSTANCED_DEFINES),
+    shader_light_source_instanced_("../src/shader/LightSource.vert",
+                                   "../src/shader/VertexColor.frag",
+                                   INSTANCED_DEFINES),
+    shader_shadow_instanced_("../src/shader/Shadow.vert",
+                             "../src/shader/Shadow.frag",
+                             INSTANCED_DEFINES),
+    shader_phong_tessellated_("../src/shader/Patch.vert",
+                              "../src/shader/BezierPatch.tesc",
+                              "../src/shader/BezierPatch.tese",
+                              "../src/shader/Phong.frag"),
+    shader_shadow_tessellated_("../src/shader/Patch.vert",
+                               "../src/shader/BezierPatch.tesc",
+                               "../src/shader/BezierPatch.tese",
+                               "../src/shader/Shadow.frag",
+                               DEPTH_ONLY_DEFINES),
+    phong_locations_(),
+    shadow_model_location_(-1),
+    light_source_model_location_(-1),
+    phong_tessellated_locations_(),
+    shadow_tessellated_model_location_(-1),
+    stream_(INITIAL_STREAM_CAPACITY),
+    uniform_alignment_(1),
+    material_table_(MATERIALS_BINDING),
     screen_width_(screen_width),
     screen_height_(screen_height),
     shadow_map_width_(1024),
@@ -27,9 +124,46 @@ TableSceneRenderer::TableSceneRenderer(int screen_width, int screen_height):
     depth_map_tex_(0),
     depth_map_fbo_(0)
 {
+    // Share the per frame uniform block between programs.
+    shader_phong_.bindUniformBlock("FrameData", FRAME_DATA_BINDING);
+    shader_light_source_.bindUniformBlock("FrameData", FRAME_DATA_BINDING);
+    shader_shadow_.bindUniformBlock("FrameData", FRAME_DATA_BINDING);
+    shader_phong_.bindUniformBlock("Materials", MATERIALS_BINDING);
+    shader_phong_instanced_.bindUniformBlock("FrameData", FRAME_DATA_BINDING);
+    shader_light_source_instanced_.bindUniformBlock("FrameData", FRAME_DATA_BINDING);
+    shader_shadow_instanced_.bindUniformBlock("FrameData", FRAME_DATA_BINDING);
+    shader_phong_instanced_.bindUniformBlock("Materials", MATERIALS_BINDING);
+    shader_phong_tessellated_.bindUniformBlock("FrameData", FRAME_DATA_BINDING);
+    shader_shadow_tessellated_.bindUniformBlock("FrameData", FRAME_DATA_BINDING);
+    shader_phong_tessellated_.bindUniformBlock("Materials", MATERIALS_BINDING);
+
+    GLint uniform_alignment = 1;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniform_alignment);
+    uniform_alignment_ = static_cast<size_t>(uniform_alignment);
+
+    // Look up the per object uniforms once.
+    phong_locations_.model = shader_phong_.uniformLocation("u_model");
+    phong_locations_.model_view = shader_phong_.uniformLocation("u_model_view");
+    phong_locations_.normal_matrix = shader_phong_.uniformLocation("u_normal_matrix");
+    phong_locations_.material_index = shader_phong_.uniformLocation("u_material_index");
+    shadow_model_location_ = shader_shadow_.uniformLocation("u_model");
+    light_source_model_location_ = shader_light_source_.uniformLocation("u_model");
+    phong_tessellated_locations_.model = shader_phong_tessellated_.uniformLocation("u_model");
+    phong_tessellated_locations_.model_view = shader_phong_tessellated_.uniformLocation("u_model_view");
+    phong_tessellated_locations_.normal_matrix = shader_phong_tessellated_.uniformLocation("u_normal_matrix");
+    phong_tessellated_locations_.material_index = shader_phong_tessellated_.uniformLocation("u_material_index");
+    shadow_tessellated_model_location_ = shader_shadow_tessellated_.uniformLocation("u_model");
+
+    // Sampler slots never change.
+    for (const ShaderProgram* program : {&shader_phong_, &shader_phong_instanced_, &shader_phong_tessellated_}) {
+        program->use();
+        program->setUniform1i("shadow_map", SHADOW_MAP_SLOT);
+        program->setUniform1i("object_texture", OBJECT_TEXTURE_SLOT);
+    }
+
     // Setup shadow map texture.
     glGenTextures(1, &depth_map_tex_);
-    glBindTexture(GL_TEXTURE_2D, depth_map_tex_);
+    GlState::bindTexture(SHADOW_MAP_SLOT, depth_map_tex_);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32,
                  shadow_map_width_, shadow_map_height_, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
@@ -39,7 +173,7 @@ TableSceneRenderer::TableSceneRenderer(int screen_width, int screen_height):
 
     // Setup shadow map Framebuffer Object.
     glGenFramebuffers(1, &depth_map_fbo_);
-    glBindFramebuffer(GL_FRAMEBUFFER, depth_map_fbo_);
+    GlState::bindFramebuffer(depth_map_fbo_);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depth_map_tex_, 0);
     if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
         cout << "Framebuffer not complete..." << endl;
@@ -47,18 +181,13 @@ TableSceneRenderer::TableSceneRenderer(int screen_width, int screen_height):
 
     glDrawBuffer(GL_NONE);
     glReadBuffer(GL_NONE);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    GlState::bindFramebuffer(0);
 }
 
 void TableSceneRenderer::renderTableScene(const TableScene& scene,
                                           const Camera& camera,
                                           const RenderParameter& params)
 {
-    // --- Shadow pass --- //
-    glViewport(0, 0, shadow_map_width_, shadow_map_height_);
-    glBindFramebuffer(GL_FRAMEBUFFER, depth_map_fbo_);
-    glClear(GL_DEPTH_BUFFER_BIT);
-
     // Define light source camera.
     Camera light_source_camera(static_cast<float>(shadow_map_width_) / shadow_map_height_);
     vec3 light_position = vec3(scene.point_light_node->worldTransformation()[3]);
@@ -66,161 +195,420 @@ void TableSceneRenderer::renderTableScene(const TableScene& scene,
     light_source_camera.lookAt(vec3(0.0f, 0.0f, 0.0f));
     light_source_camera.updateView();
 
-    shader_shadow_.use();
-    shader_shadow_.setUniformMat4f("u_light_view", light_source_camera.view());
-    shader_shadow_.setUniformMat4f("u_light_projection", light_source_camera.projection());
-
-    // Draw table for shadow pass.
-    for (int i = 0; i < scene.table_node->subnodes.size(); ++i) {
-        auto* node = scene.table_node->subnodes[i].get();
-        auto model = node->worldTransformation();
-        shader_shadow_.setUniformMat4f("u_model", model);
-        node->mesh->draw();
+    // Upload materials changed since the last frame, e.g. by the GUI.
+    material_table_.update(scene.materials);
+
+    stats_ = RenderStats();
+
+    // Collect the draws of both passes. Static batches are not in the arena, so they are only
+    // used without it.
+    const bool use_arena = params.multi_draw_indirect && !scene.geometry().isEmpty();
+    candidates_.clear();
+    candidate_spheres_.clear();
+    collectDraws(scene, scene.root(), params.hardware_tessellation, params.static_batching && !use_arena);
+
+    // Test all bounds against the frustum of each pass at once.
+    const size_t n_candidates = candidates_.size();
+    in_view_.assign(n_candidates, 1);
+    in_light_view_.assign(n_candidates, 1);
+    if (params.frustum_culling) {
+        cullSpheres(camera.frustum(), candidate_spheres_.data(), n_candidates, in_view_.data());
+        cullSpheres(light_source_camera.frustum(), candidate_spheres_.data(), n_candidates,
+                    in_light_view_.data());
     }
 
-    // Draw torus for shadow pass.
-    {
-        auto model = scene.torus_node->worldTransformation();
-        shader_shadow_.setUniformMat4f("u_model", model);
-        scene.torus_node->mesh->draw();
+    // Queue and sort the visible draws.
+    queue_.clear();
+    for (size_t i = 0; i < n_candidates; ++i)
+        queueDraws(scene, candidates_[i], camera, light_source_camera, in_view_[i], in_light_view_[i]);
+    queue_.sort();
+
+    // Draw from the geometry arena, if every mesh is in it.
+    const GeometryArena* arena = nullptr;
+    if (use_arena) {
+        arena = &scene.geometry();
+        for (const auto& item : queue_.items()) {
+            if (arena->find(item.mesh) == nullptr) {
+                arena = nullptr;
+                break;
+            }
+        }
     }
 
-    // Draw teapot for shadow pass.
-    {
-        auto model = scene.teapot_node->worldTransformation();
-        shader_shadow_.setUniformMat4f("u_model", model);
-        scene.teapot_node->mesh->draw();
-    }
+    buildBatches(arena);
 
-    // Draw Sphere for shadow pass.
+    // Write the data of the frame to its region of the stream buffer.
+    const size_t frame_size = sizeof(FrameData) + uniform_alignment_
+                              + InstanceBuffer::streamSize(instances_.size())
+                              + DrawCommandBuffer::streamSize(commands_.size());
+    if (stream_.beginFrame(frame_size))
+        stats_.stream_stalls++;
     {
-        auto model = scene.sphere_node->worldTransformation();
-        shader_shadow_.setUniformMat4f("u_model", model);
-        scene.sphere_node->mesh->draw();
+        const StreamBuffer::Range range = stream_.allocate(sizeof(FrameData), uniform_alignment_);
+        FrameData* frame_data = static_cast<FrameData*>(range.data);
+        frame_data->view = camera.view();
+        frame_data->projection = camera.projection();
+        frame_data->light_view = light_source_camera.view();
+        frame_data->light_projection = light_source_camera.projection();
+        frame_data->light_position = light_position;
+        // Update lighting parameters from GUI.
+        frame_data->ambient_coef = params.ambient;
+        frame_data->diffuse_coef = params.diffuse;
+        frame_data->specular_coef = params.specular;
+        glBindBufferRange(GL_UNIFORM_BUFFER, FRAME_DATA_BINDING, stream_.getId(), range.offset, sizeof(FrameData));
     }
+    instance_buffer_.update(stream_, instances_);
+    command_buffer_.update(stream_, commands_);
+    stream_.endWrites();
 
-    // Draw floor for shadow pass.
-    {
-        auto model = scene.floor_node->worldTransformation();
-        shader_shadow_.setUniformMat4f("u_model", model);
-        scene.floor_node->mesh->draw();
+    if (arena != nullptr) {
+        instance_buffer_.attach(arena->getId(), 0);
+        instance_buffer_.attach(arena->getDepthId(), 0);
     }
 
-    // Render pass.
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glViewport(0, 0, screen_width_, screen_height_);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, depth_map_tex_);
-
     //shader_shadow_debug.use();
     //shader_shadow_debug.setUniform1i("shadow_map", 0);
     //glBindVertexArray(quad.vao);
     //quad.draw();
 
-    // Determine shader to be used.
-    ShaderProgram& shader = shader_phong_;
-
-    shader.use();
-    shader.setUniformMat4f("u_view", camera.view());
-    shader.setUniformMat4f("u_projection", camera.projection());
-    shader.setUniformMat4f("u_light_view", light_source_camera.view());
-    shader.setUniformMat4f("u_light_projection", light_source_camera.projection());
-    shader.setUniform1i("shadow_map", 0);
-    shader.setUniformVec3f("u_light_position", light_position);
-
-    // Update lighting parameters from GUI.
-    shader.setUniform1f("u_ambient_coef", params.ambient);
-    shader.setUniform1f("u_diffuse_coef", params.diffuse);
-    shader.setUniform1f("u_specular_coef", params.specular);
-
-    // Set texture sampler slot.
-    const int sampler_slot = 1;
-    shader.setUniform1i("object_texture", sampler_slot);
-
-    // Draw table.
-    for (int i = 0; i < scene.table_node->subnodes.size(); ++i) {
-        auto* node = scene.table_node->subnodes[i].get();
-        auto model = node->worldTransformation();
-        shader.setUniformMat4f("u_model", model);
-        shader.setUniformVec3f("u_ka", scene.table_material.ka);
-        shader.setUniformVec3f("u_kd", scene.table_material.kd);
-        shader.setUniformVec3f("u_ks", scene.table_material.ks);
-        shader.setUniform1f("u_shiny", scene.table_material.shiny);
-
-        const auto& tex = scene.textures[0];
-        tex.bind(sampler_slot);
-        node->mesh->draw();
-        tex.unbind();
-    }
-
-    // Draw torus.
-    {
-        auto model = scene.torus_node->worldTransformation();
-        shader.setUniformMat4f("u_model", model);
-        shader.setUniformVec3f("u_ka", scene.torus_material.ka);
-        shader.setUniformVec3f("u_kd", scene.torus_material.kd);
-        shader.setUniformVec3f("u_ks", scene.torus_material.ks);
-        shader.setUniform1f("u_shiny", scene.torus_material.shiny);
+    // Draws are sorted by pass first, so each pass is a contiguous range of batches.
+    const auto& items = queue_.items();
+    size_t first = 0;
+    for (const RenderPass pass : {SHADOW_PASS, COLOR_PASS}) {
+        size_t last = first;
+        while (last < batches_.size() && RenderQueue::keyPass(items[batches_[last].first].key) == pass)
+            ++last;
+
+        beginPass(pass);
+        const mat4& view = pass == SHADOW_PASS ? light_source_camera.view() : camera.view();
+        if (arena != nullptr)
+            submitMultiDraws(first, last, *arena);
+        else
+            submitBatches(first, last, view);
+        if (params.hardware_tessellation)
+            submitTeapotPatches(scene, pass, view);
+        first = last;
+    }
 
-        const auto& tex = scene.textures[2];
-        tex.bind(sampler_slot);
-        scene.torus_node->mesh->draw();
-        tex.unbind();
+    stream_.endFrame();
+}
+
+const RenderStats& TableSceneRenderer::stats() const
+{
+    return stats_;
+}
+
+void TableSceneRenderer::collectDraws(const TableScene& scene,
+                                      SceneNode* node,
+                                      bool skip_teapot,
+                                      bool use_static_batches)
+{
+    if (use_static_batches && node->is_static) {
+        if (StaticBatch* batch = staticBatch(node)) {
+            addCandidate(node, batch->mesh(), batch->material(), batch->texture());
+            return;
+        }
     }
 
-    // Draw teapot.
-    {
-        auto model = scene.teapot_node->worldTransformation();
-        shader.setUniformMat4f("u_model", model);
-        shader.setUniformVec3f("u_ka", scene.teapot_material.ka);
-        shader.setUniformVec3f("u_kd", scene.teapot_material.kd);
-        shader.setUniformVec3f("u_ks", scene.teapot_material.ks);
-        shader.setUniform1f("u_shiny", scene.teapot_material.shiny);
+    if (node->mesh != nullptr && !(skip_teapot && node == scene.teapot_node))
+        addCandidate(node, node->mesh, node->material, node->texture);
 
-        const auto& tex = scene.textures[params.teapot_tex];
-        tex.bind(sampler_slot);
-        scene.teapot_node->mesh->draw();
-        tex.unbind();
+    for (auto* subnode : node->subnodes) {
+        collectDraws(scene, subnode, skip_teapot, use_static_batches);
     }
+}
 
-    // Draw sphere.
-    {
-        auto model = scene.sphere_node->worldTransformation();
-        shader.setUniformMat4f("u_model", model);
-        shader.setUniformVec3f("u_ka", scene.sphere_material.ka);
-        shader.setUniformVec3f("u_kd", scene.sphere_material.kd);
-        shader.setUniformVec3f("u_ks", scene.sphere_material.ks);
-        shader.setUniform1f("u_shiny", scene.sphere_material.shiny);
+void TableSceneRenderer::addCandidate(SceneNode* node, Mesh* mesh, int material, int texture)
+{
+    candidates_.push_back({node, mesh, material, texture});
+    // Mesh bounds are in object space, before dequantization.
+    candidate_spheres_.push_back(transformBoundingSphere(mesh->boundingSphere(), node->worldTransformation()));
+}
 
-        const auto& tex = scene.textures[2];
-        tex.bind(sampler_slot);
-        scene.sphere_node->mesh->draw();
-        tex.unbind();
+void TableSceneRenderer::queueDraws(const TableScene& scene,
+                                    const DrawCandidate& candidate,
+                                    const Camera& camera,
+                                    const Camera& light_source_camera,
+                                    bool in_view,
+                                    bool in_light_view)
+{
+    SceneNode* node = candidate.node;
+    Mesh* mesh = candidate.mesh;
+    const unsigned int mesh_id = mesh->getId();
+
+    if (node == scene.point_light_node) {
+        // The light source is drawn unlit, and does not cast shadows.
+        if (!in_view) {
+            stats_.culled_draws++;
+            return;
+        }
+        DrawItem item{0, node, mesh, &shader_light_source_, nullptr, 0};
+        item.key = RenderQueue::makeSortKey(COLOR_PASS, shader_light_source_.getId(), 0, 0,
+                                            mesh_id, sortDepth(node, camera));
+        queue_.push(item);
+        return;
     }
 
-    // Draw floor.
-    {
-        auto model = scene.floor_node->worldTransformation();
-        shader.setUniformMat4f("u_model", model);
-        shader.setUniformVec3f("u_ka", scene.floor_material.ka);
-        shader.setUniformVec3f("u_kd", scene.floor_material.kd);
-        shader.setUniformVec3f("u_ks", scene.floor_material.ks);
-        shader.setUniform1f("u_shiny", scene.floor_material.shiny);
+    if (in_light_view) {
+        DrawItem shadow_item{0, node, mesh, &shader_shadow_, nullptr, 0};
+        shadow_item.key = RenderQueue::makeSortKey(SHADOW_PASS, shader_shadow_.getId(), 0, 0,
+                                                   mesh_id, sortDepth(node, light_source_camera));
+        queue_.push(shadow_item);
+    }
+    else {
+        stats_.culled_draws++;
+    }
+
+    if (in_view) {
+        const Texture* texture = candidate.texture >= 0 ? &scene.textures[candidate.texture] : nullptr;
+        DrawItem color_item{0, node, mesh, &shader_phong_, texture, candidate.material};
+        color_item.key = RenderQueue::makeSortKey(COLOR_PASS,
+                                                  shader_phong_.getId(),
+                                                  texture != nullptr ? texture->getId() : 0,
+                                                  static_cast<unsigned int>(candidate.material),
+                                                  mesh_id,
+                                                  sortDepth(node, camera));
+        queue_.push(color_item);
+    }
+    else {
+        stats_.culled_draws++;
+    }
+}
 
-        const auto& tex = scene.textures[1];
-        tex.bind(sampler_slot);
-        scene.floor_node->mesh->draw();
-        tex.unbind();
+StaticBatch* TableSceneRenderer::staticBatch(SceneNode* root)
+{
+    auto it = find_if(static_batches_.begin(), static_batches_.end(),
+                      [root](const unique_ptr<StaticBatch>& batch) { return batch->root() == root; });
+
+    // The subtree may have changed so that it cannot be batched anymore.
+    if (!StaticBatch::canBatch(root)) {
+        if (it != static_batches_.end())
+            static_batches_.erase(it);
+        return nullptr;
     }
 
-    // Draw light source.
-    {
-        shader_light_source_.use();
-        shader_light_source_.setUniformMat4f("u_view", camera.view());
-        shader_light_source_.setUniformMat4f("u_projection", camera.projection());
-        auto model = scene.point_light_node->worldTransformation();
-        shader_light_source_.setUniformMat4f("u_model", model);
-        scene.point_light_node->mesh->draw();
+    if (it == static_batches_.end()) {
+        // Same format as the scene meshes.
+        MeshUploadOptions upload_options;
+        upload_options.format = VertexFormat::PACKED;
+        upload_options.position_stream = true;
+        upload_options.optimize = true;
+        static_batches_.push_back(make_unique<StaticBatch>(root, upload_options));
+        return static_batches_.back().get();
+    }
+
+    (*it)->update();
+    return it->get();
+}
+
+void TableSceneRenderer::beginPass(RenderPass pass)
+{
+    if (pass == SHADOW_PASS) {
+        GlState::viewport(0, 0, shadow_map_width_, shadow_map_height_);
+        GlState::bindFramebuffer(depth_map_fbo_);
+        glClear(GL_DEPTH_BUFFER_BIT);
+    }
+    else {
+        GlState::bindFramebuffer(0);
+        GlState::viewport(0, 0, screen_width_, screen_height_);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        GlState::bindTexture(SHADOW_MAP_SLOT, depth_map_tex_);
+    }
+}
+
+void TableSceneRenderer::buildBatches(const GeometryArena* arena)
+{
+    const auto& items = queue_.items();
+    const size_t min_instances = arena != nullptr ? 1 : MIN_INSTANCES;
+
+    batches_.clear();
+    instances_.clear();
+    commands_.clear();
+
+    size_t first = 0;
+    while (first < items.size()) {
+        const DrawItem& item = items[first];
+        size_t last = first + 1;
+        while (last < items.size()
+               && items[last].program == item.program
+               && items[last].texture == item.texture
+               && items[last].material == item.material
+               && items[last].mesh == item.mesh)
+            ++last;
+
+        DrawBatch batch{first, last - first, instances_.size()};
+        if (batch.count >= min_instances) {
+            for (size_t i = first; i < last; ++i) {
+                SceneNode* node = items[i].node;
+                instances_.push_back({modelMatrix(items[i]),
+                                      node->worldNormalMatrix(),
+                                      items[i].material});
+            }
+        }
+        batches_.push_back(batch);
+
+        if (arena != nullptr) {
+            const MeshRange* range = arena->find(item.mesh);
+            commands_.push_back({range->index_count,
+                                 static_cast<unsigned int>(batch.count),
+                                 range->first_index,
+                                 range->base_vertex,
+                                 static_cast<unsigned int>(batch.first_instance)});
+        }
+        first = last;
     }
 }
+
+void TableSceneRenderer::submitBatches(size_t first, size_t last, const mat4& view)
+{
+    const auto& items = queue_.items();
+
+    // Currently bound state. Nothing is assumed to be bound at the start of a pass.
+    const ShaderProgram* program = nullptr;
+    const Texture* texture = nullptr;
+    const Mesh* mesh = nullptr;
+    int material = -1;
+
+    for (size_t b = first; b < last; ++b) {
+        const DrawBatch& batch = batches_[b];
+        const DrawItem& item = items[batch.first];
+        const bool is_instanced = batch.count >= MIN_INSTANCES;
+        // Shadow draws only need positions.
+        const bool is_depth_only = item.program == &shader_shadow_;
+
+        const ShaderProgram* batch_program = is_instanced ? &instancedProgram(*item.program)
+                                                          : item.program;
+        if (batch_program != program) {
+            program = batch_program;
+            program->use();
+            material = -1;
+            stats_.program_changes++;
+        }
+
+        if (item.texture != nullptr && item.texture != texture) {
+            texture = item.texture;
+            texture->bind(OBJECT_TEXTURE_SLOT);
+            stats_.texture_changes++;
+        }
+
+        if (item.mesh != mesh) {
+            mesh = item.mesh;
+            stats_.mesh_changes++;
+        }
+
+        // Instanced draws read their material from the instance buffer.
+        if (is_instanced) {
+            const int count = static_cast<int>(batch.count);
+            if (is_depth_only) {
+                instance_buffer_.attach(item.mesh->getDepthId(), batch.first_instance);
+                item.mesh->drawDepthInstanced(count);
+            }
+            else {
+                instance_buffer_.attach(item.mesh->getId(), batch.first_instance);
+                item.mesh->drawInstanced(count);
+            }
+            stats_.draws++;
+            continue;
+        }
+
+        // Per object uniforms.
+        if (program == &shader_phong_) {
+            if (item.material != material) {
+                material = item.material;
+                ShaderProgram::setUniform1i(phong_locations_.material_index, material);
+                stats_.material_changes++;
+            }
+            setModelUniforms(phong_locations_, view, item);
+        }
+        else if (program == &shader_shadow_) {
+            ShaderProgram::setUniformMat4f(shadow_model_location_, modelMatrix(item));
+        }
+        else {
+            ShaderProgram::setUniformMat4f(light_source_model_location_, modelMatrix(item));
+        }
+
+        if (is_depth_only)
+            item.mesh->drawDepth();
+        else
+            item.mesh->draw();
+        stats_.draws++;
+    }
+}
+
+void TableSceneRenderer::submitMultiDraws(size_t first, size_t last, const GeometryArena& arena)
+{
+    const auto& items = queue_.items();
+
+    const ShaderProgram* program = nullptr;
+    const Texture* texture = nullptr;
+
+    size_t run_begin = first;
+    while (run_begin < last) {
+        const DrawItem& item = items[batches_[run_begin].first];
+
+        // Batches sharing program and texture only differ by mesh, material and transforms,
+        // which all come from the commands and the instance buffer.
+        size_t run_end = run_begin + 1;
+        while (run_end < last) {
+            const DrawItem& next = items[batches_[run_end].first];
+            if (next.program != item.program || next.texture != item.texture)
+                break;
+            ++run_end;
+        }
+
+        const ShaderProgram* run_program = &instancedProgram(*item.program);
+        if (run_program != program) {
+            program = run_program;
+            program->use();
+            stats_.program_changes++;
+        }
+
+        if (item.texture != nullptr && item.texture != texture) {
+            texture = item.texture;
+            texture->bind(OBJECT_TEXTURE_SLOT);
+            stats_.texture_changes++;
+        }
+
+        const bool is_depth_only = item.program == &shader_shadow_;
+        arena.multiDraw(command_buffer_, run_begin, run_end - run_begin, is_depth_only);
+        stats_.draws++;
+        run_begin = run_end;
+    }
+}
+
+void TableSceneRenderer::submitTeapotPatches(const TableScene& scene, RenderPass pass, const mat4& view)
+{
+    SceneNode* node = scene.teapot_node;
+    // Control points are not quantized, so the node transformation is the model matrix.
+    const mat4& model = node->worldTransformation();
+
+    if (pass == SHADOW_PASS) {
+        shader_shadow_tessellated_.use();
+        ShaderProgram::setUniformMat4f(shadow_tessellated_model_location_, model);
+    }
+    else {
+        shader_phong_tessellated_.use();
+        ShaderProgram::setUniform1i(phong_tessellated_locations_.material_index, node->material);
+        ShaderProgram::setUniformMat4f(phong_tessellated_locations_.model, model);
+        ShaderProgram::setUniformMat4f(phong_tessellated_locations_.model_view, view * model);
+        ShaderProgram::setUniformMat3f(phong_tessellated_locations_.normal_matrix,
+                                       mat3(view) * node->worldNormalMatrix());
+        if (node->texture >= 0)
+            scene.textures[node->texture].bind(OBJECT_TEXTURE_SLOT);
+    }
+    stats_.program_changes++;
+
+    scene.teapotPatches().draw();
+    stats_.draws++;
+}
+
+const ShaderProgram& TableSceneRenderer::instancedProgram(const ShaderProgram& program) const
+{
+    if (&program == &shader_phong_)
+        return shader_phong_instanced_;
+    if (&program == &shader_shadow_)
+        return shader_shadow_instanced_;
+
+    assert(&program == &shader_light_source_);
+    return shader_light_source_instanced_;
+}
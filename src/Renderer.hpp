@@ -1,10 +1,25 @@
 #ifndef RENDERER_HPP
 #define RENDERER_HPP
 
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+
+#include "DrawCommandBuffer.hpp"
+#include "InstanceBuffer.hpp"
+#include "MaterialTable.hpp"
+#include "RenderQueue.hpp"
 #include "ShaderProgram.hpp"
+#include "StaticBatch.hpp"
+#include "StreamBuffer.hpp"
 
 class Camera;
+class GeometryArena;
 class TableScene;
+struct SceneNode;
 
 // Crucial elements:
 // - Render target
@@ -18,8 +33,29 @@ struct RenderParameter
     float diffuse = 1.0f;
     float specular = 1.0f;
 
-    // Teapot texture.
-    int teapot_tex = 3;
+    // Submit each pass with a few multi-draw calls, when the scene geometry is in an arena.
+    bool multi_draw_indirect = true;
+
+    // Draw the teapot from its Bezier patches, evaluated by tessellation shaders.
+    bool hardware_tessellation = false;
+
+    // Draw static subtrees from merged meshes, see StaticBatch. Only without multi-draw, which
+    // already submits them at once from the arena.
+    bool static_batching = true;
+
+    // Skip draws whose bounds are outside the camera frustum, or the light frustum in the shadow
+    // pass.
+    bool frustum_culling = true;
+};
+
+
+// Locations of the uniforms set for every object drawn with the Phong program.
+struct PhongUniformLocations
+{
+    int model;
+    int model_view;
+    int normal_matrix;
+    int material_index;
 };
 
 
@@ -35,12 +71,117 @@ public:
 
     void renderPhongMaterial();
 
+    // Counters of the last rendered frame.
+    const RenderStats& stats() const;
+
 private:
 
+    // Render passes, in submission order.
+    enum RenderPass : unsigned int
+    {
+        SHADOW_PASS = 0,
+        COLOR_PASS = 1
+    };
+
+    // Run of queued draws sharing program, texture, material and mesh.
+    struct DrawBatch
+    {
+        size_t first;
+        size_t count;
+        // Offset of the batch in the instance buffer, if it is drawn instanced.
+        size_t first_instance;
+    };
+
+    // Mesh drawn with the transformation of a node, before culling.
+    struct DrawCandidate
+    {
+        SceneNode* node;
+        Mesh* mesh;
+        int material;
+        int texture;
+    };
+
+    // Traverse the scene tree and list the candidates of every node with a mesh, along with their
+    // world bounds. The teapot is left out when it is drawn from its patches. Static subtrees are
+    // drawn from their batch, if `use_static_batches` is set and they can be batched.
+    void collectDraws(const TableScene& scene,
+                      SceneNode* node,
+                      bool skip_teapot,
+                      bool use_static_batches);
+    void addCandidate(SceneNode* node, Mesh* mesh, int material, int texture);
+    // Queue the draws of a candidate in the passes it is visible in.
+    void queueDraws(const TableScene& scene,
+                    const DrawCandidate& candidate,
+                    const Camera& camera,
+                    const Camera& light_source_camera,
+                    bool in_view,
+                    bool in_light_view);
+    // Up to date batch of a static subtree, created on first use, or nullptr if the subtree
+    // cannot be batched.
+    StaticBatch* staticBatch(SceneNode* root);
+    // Bind and clear the render target of a pass.
+    void beginPass(RenderPass pass);
+    // Group the sorted draws in batches, and fill the instance buffer of the instanced ones.
+    // With an arena, every batch is instanced and gets an indirect draw command.
+    void buildBatches(const GeometryArena* arena);
+    // Submit the batches in [first, last), skipping redundant state changes.
+    void submitBatches(size_t first, size_t last, const glm::mat4& view);
+    // Submit the batches in [first, last) from the arena, with one multi-draw per program and
+    // texture.
+    void submitMultiDraws(size_t first, size_t last, const GeometryArena& arena);
+    // Draw the teapot patches with the tessellated program of a pass.
+    void submitTeapotPatches(const TableScene& scene, RenderPass pass, const glm::mat4& view);
+    // Variant of a program reading transforms from the instance buffer.
+    const ShaderProgram& instancedProgram(const ShaderProgram& program) const;
+
     ShaderProgram shader_phong_;
     ShaderProgram shader_light_source_;
     ShaderProgram shader_shadow_;
     ShaderProgram shader_shadow_debug_;
+    // Instanced variants.
+    ShaderProgram shader_phong_instanced_;
+    ShaderProgram shader_light_source_instanced_;
+    ShaderProgram shader_shadow_instanced_;
+    // Variants evaluating Bezier patches in tessellation shaders.
+    ShaderProgram shader_phong_tessellated_;
+    ShaderProgram shader_shadow_tessellated_;
+
+    // Uniform locations, reflected once at startup.
+    PhongUniformLocations phong_locations_;
+    int shadow_model_location_;
+    int light_source_model_location_;
+    PhongUniformLocations phong_tessellated_locations_;
+    int shadow_tessellated_model_location_;
+
+    // Data rewritten every frame: the frame uniforms shared by all programs, the instances and
+    // the indirect draw commands.
+    StreamBuffer stream_;
+    // Alignment of uniform block ranges in the stream buffer.
+    size_t uniform_alignment_;
+    // Materials of the scene, uploaded only when they change.
+    MaterialTable material_table_;
+
+    // Draws of the current frame, and counters of the last submitted frame.
+    RenderQueue queue_;
+    RenderStats stats_;
+
+    // Batches of the current frame, and transforms of their instances, uploaded once per frame.
+    std::vector<DrawBatch> batches_;
+    std::vector<InstanceData> instances_;
+    InstanceBuffer instance_buffer_;
+    // Draws of the current frame before culling, their world bounding spheres packed as
+    // (center, radius), and whether they are in the camera and light frustums.
+    std::vector<DrawCandidate> candidates_;
+    std::vector<glm::vec4> candidate_spheres_;
+    std::vector<uint8_t> in_view_;
+    std::vector<uint8_t> in_light_view_;
+
+    // Merged meshes of the static subtrees met so far.
+    std::vector<std::unique_ptr<StaticBatch>> static_batches_;
+
+    // Indirect draw commands of the batches, when drawing from the scene geometry arena.
+    std::vector<DrawCommand> commands_;
+    DrawCommandBuffer command_buffer_;
 
     // Screen resolution.
     int screen_width_;
@@ -15,7 +15,9 @@ TableScene::TableScene():
     square_(createSquare()),
     sphere_(createSphere(30, 30)),
     torus_(createTorus(1.0f, 0.15f)),
-    teapot_(createTeapot(2.0f)),
+    // Within the worst error of a uniform sample density of 2, with about 40% fewer triangles.
+    teapot_(createAdaptiveTeapot(0.05f)),
+    teapot_patches_(16),
     // Objects.
     table_node(nullptr),
     sphere_node(nullptr),
@@ -31,18 +33,41 @@ TableScene::TableScene():
     textures.emplace_back("../assets/chess.jpeg");
     textures.emplace_back("../assets/psycho1.jpeg");
 
+    // Create materials.
+    sphere_material = 0;
+    torus_material = 1;
+    table_material = 2;
+    teapot_material = 3;
+    floor_material = 4;
+    materials.resize(5);
+
     // Change a few material parameters.
-    table_material.ka = vec3(128.f, 83.f, 0.f) / 255.f;
-    table_material.kd = vec3(181.f, 88.f, 0.f) / 255.f;
-    sphere_material.ka = vec3(0.1f, 0.1f, 0.6f);
-    teapot_material.shiny = 200.f;
-
-    // Push mesh data to GPU.
-    cube_.pushToGpu();
-    square_.pushToGpu();
-    sphere_.pushToGpu();
-    torus_.pushToGpu();
-    teapot_.pushToGpu();
+    materials[table_material].ka = vec3(128.f, 83.f, 0.f) / 255.f;
+    materials[table_material].kd = vec3(181.f, 88.f, 0.f) / 255.f;
+    materials[sphere_material].ka = vec3(0.1f, 0.1f, 0.6f);
+    materials[teapot_material].shiny = 200.f;
+
+    // Push mesh data to GPU, in the packed vertex format: half the size of float vertices.
+    // Positions are also kept alone for the shadow pass.
+    MeshUploadOptions upload_options;
+    upload_options.format = VertexFormat::PACKED;
+    upload_options.position_stream = true;
+    upload_options.optimize = true;
+    for (Mesh* mesh : {&cube_, &square_, &sphere_, &torus_, &teapot_})
+        mesh->pushToGpu(upload_options);
+
+    // The teapot patches are only a few kilobytes of control points.
+    for (const auto& point : teapotControlPoints())
+        teapot_patches_.control_points.emplace_back(point[0], point[1], point[2]);
+    teapot_patches_.indices.assign(teapotPatchIndices().begin(), teapotPatchIndices().end());
+    teapot_patches_.pushToGpu();
+
+    // Also suballocate them from one shared arena, if they can be drawn from it.
+    if (GeometryArena::isMultiDrawSupported()) {
+        for (const Mesh* mesh : {&cube_, &square_, &sphere_, &torus_, &teapot_})
+            geometry_.add(*mesh);
+        geometry_.pushToGpu(true);
+    }
 
     // Table variables.
     const float table_length = 2.0f;
@@ -52,8 +77,9 @@ TableScene::TableScene():
     const float top_height = 0.1f;
     const float top_scale_factor = 1.1f;
 
-    // Table object.
+    // Table object. Its parts never move, so they can be drawn as one mesh.
     table_node = root_->makeSubnode();
+    table_node->is_static = true;
     // Legs.
     {
         const vec3 leg_scale = vec3(leg_width, leg_height, leg_width);
@@ -65,53 +91,68 @@ TableScene::TableScene():
         };
         for (int i = 0; i < 4; ++i) {
             SceneNode* leg_object = table_node->makeSubnode();
-            leg_object->pos = leg_position[i];
-            leg_object->scale = leg_scale;
+            leg_object->setPosition(leg_position[i]);
+            leg_object->setScale(leg_scale);
             leg_object->mesh = &cube_;
+            leg_object->material = table_material;
+            leg_object->texture = 0;
         }
     }
     // Top.
     {
         SceneNode* top_object = table_node->makeSubnode();
-        top_object->pos = vec3(0.0f, leg_height + top_height/2, 0.0f);
-        top_object->scale = vec3(top_scale_factor * table_width,
-                                 top_height,
-                                 top_scale_factor * table_length);
+        top_object->setPosition(vec3(0.0f, leg_height + top_height/2, 0.0f));
+        top_object->setScale(vec3(top_scale_factor * table_width,
+                                  top_height,
+                                  top_scale_factor * table_length));
         top_object->mesh = &cube_;
+        top_object->material = table_material;
+        top_object->texture = 0;
     }
 
     const float table_top_y = leg_height + top_height;
 
     // Sphere object.
     sphere_node = root_->makeSubnode();
-    sphere_node->pos = vec3{0.0f, table_top_y + 0.8f, -0.5f};
-    sphere_node->scale = vec3(0.35f);
+    sphere_node->setPosition(vec3{0.0f, table_top_y + 0.8f, -0.5f});
+    sphere_node->setScale(vec3(0.35f));
     sphere_node->mesh = &sphere_;
+    sphere_node->material = sphere_material;
+    sphere_node->texture = 2;
 
     // Torus object.
     torus_node = root_->makeSubnode();
-    torus_node->pos = sphere_node->pos;
-    torus_node->scale = vec3(0.5f);
+    torus_node->setPosition(sphere_node->position());
+    torus_node->setScale(vec3(0.5f));
     torus_node->mesh = &torus_;
+    torus_node->material = torus_material;
+    torus_node->texture = 2;
 
     // Teapot object.
     teapot_node = root_->makeSubnode();
-    teapot_node->pos = vec3(0.0f, table_top_y + 0.01f, 0.65f);
-    teapot_node->ori_y = vec3(0.0f, 0.0f, -1.0f);
-    teapot_node->ori_z = cross(teapot_node->ori_x, teapot_node->ori_y);
-    teapot_node->scale = vec3(0.2f);
+    teapot_node->setPosition(vec3(0.0f, table_top_y + 0.01f, 0.65f));
+    {
+        const vec3 ori_x = teapot_node->orientationX();
+        const vec3 ori_y = vec3(0.0f, 0.0f, -1.0f);
+        teapot_node->setOrientation(ori_x, ori_y, cross(ori_x, ori_y));
+    }
+    teapot_node->setScale(vec3(0.2f));
     teapot_node->mesh = &teapot_;
+    teapot_node->material = teapot_material;
+    teapot_node->texture = 3;
 
     // Floor plane object.
     floor_node = root_->makeSubnode();
-    floor_node->pos = vec3(0.0f);
-    floor_node->scale = vec3(3.5f);
+    floor_node->setPosition(vec3(0.0f));
+    floor_node->setScale(vec3(3.5f));
     floor_node->mesh = &square_;
+    floor_node->material = floor_material;
+    floor_node->texture = 1;
 
     // Light source.
     point_light_node = root_->makeSubnode();
-    point_light_node->pos = vec3{0.0f, 2.0f, 0.0f};
-    point_light_node->scale = vec3(0.1f);
+    point_light_node->setPosition(vec3{0.0f, 2.0f, 0.0f});
+    point_light_node->setScale(vec3(0.1f));
     point_light_node->mesh = &cube_;
 }
 
@@ -119,3 +160,13 @@ SceneNode* TableScene::root() const
 {
     return root_.get();
 }
+
+const GeometryArena& TableScene::geometry() const
+{
+    return geometry_;
+}
+
+const PatchMesh& TableScene::teapotPatches() const
+{
+    return teapot_patches_;
+}
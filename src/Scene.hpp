@@ -5,7 +5,9 @@
 
 #include <glm/vec3.hpp>
 
+#include "GeometryArena.hpp"
 #include "Mesh.hpp"
+#include "PatchMesh.hpp"
 #include "SceneNode.hpp"
 #include "Texture.hpp"
 
@@ -33,6 +35,13 @@ public:
 
     SceneNode* root() const;
 
+    // Shared storage of the scene meshes. Empty if multi-draw is not supported.
+    const GeometryArena& geometry() const;
+
+    // Bezier patches of the teapot, for hardware tessellation. Drawn with the transformation of
+    // teapot_node, in place of its mesh.
+    const PatchMesh& teapotPatches() const;
+
     // Scene objects.
     SceneNode* table_node;
     SceneNode* sphere_node;
@@ -41,12 +50,13 @@ public:
     SceneNode* floor_node;
     SceneNode* point_light_node;
 
-    // Phong materials.
-    PhongMaterial sphere_material;
-    PhongMaterial torus_material;
-    PhongMaterial table_material;
-    PhongMaterial teapot_material;
-    PhongMaterial floor_material;
+    // Phong materials, referenced by index from the scene nodes.
+    std::vector<PhongMaterial> materials;
+    int sphere_material;
+    int torus_material;
+    int table_material;
+    int teapot_material;
+    int floor_material;
 
     // Textures.
     std::vector<Texture> textures;
@@ -62,6 +72,9 @@ private:
     Mesh sphere_;
     Mesh torus_;
     Mesh teapot_;
+    PatchMesh teapot_patches_;
+
+    GeometryArena geometry_;
 };
 
 #endif // SCENE_HPP
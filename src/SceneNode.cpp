@@ -1,23 +1,33 @@
 #include "SceneNode.hpp"
 
+#include <deque>
 #include <utility>    // for std::move
 
-#include "Math.hpp"
-
 using namespace std;
 using glm::vec3;
 using glm::mat4;
 
+struct SceneTreeStorage
+{
+    TransformHierarchy hierarchy;
+    // A deque allocates nodes in large blocks and never moves them.
+    deque<SceneNode> nodes;
+};
+
 SceneNode::SceneNode():
-    pos(vec3(0.0f)),
-    ori_x(vec3(1.0f, 0.0f, 0.0f)),
-    ori_y(vec3(0.0f, 1.0f, 0.0f)),
-    ori_z(vec3(0.0f, 0.0f, 1.0f)),
-    scale(vec3(1.0f)),
     subnodes(),
     parent_node(nullptr),
-    mesh(nullptr)
+    mesh(nullptr),
+    material(0),
+    texture(-1),
+    is_static(false),
+    root_(this),
+    hierarchy_(nullptr),
+    id_(TransformHierarchy::NO_NODE),
+    storage_(make_unique<SceneTreeStorage>())
 {
+    hierarchy_ = &storage_->hierarchy;
+    id_ = hierarchy_->addNode();
 }
 
 SceneNode::SceneNode(Mesh* p_mesh):
@@ -28,29 +38,118 @@ SceneNode::SceneNode(Mesh* p_mesh):
     mesh = p_mesh;
 }
 
+SceneNode::SceneNode(SceneNode* p_parent, TransformHierarchy::NodeId id):
+    subnodes(),
+    parent_node(p_parent),
+    mesh(nullptr),
+    material(0),
+    texture(-1),
+    is_static(false),
+    root_(p_parent->root_),
+    hierarchy_(p_parent->hierarchy_),
+    id_(id),
+    storage_()
+{
+}
+
+SceneNode::SceneNode(SceneNode&& node):
+    subnodes(move(node.subnodes)),
+    parent_node(node.parent_node),
+    mesh(node.mesh),
+    material(node.material),
+    texture(node.texture),
+    is_static(node.is_static),
+    root_(node.root_ == &node ? this : node.root_),
+    hierarchy_(node.hierarchy_),
+    id_(node.id_),
+    storage_(move(node.storage_))
+{
+    // Relink the tree to the new address of the node.
+    for (SceneNode* subnode : subnodes)
+        subnode->parent_node = this;
+    if (storage_ != nullptr) {
+        for (auto& stored : storage_->nodes)
+            stored.root_ = this;
+    }
+}
+
 SceneNode::~SceneNode()
 {
 }
 
 SceneNode* SceneNode::makeSubnode()
 {
-    subnodes.emplace_back(make_unique<SceneNode>());
-    SceneNode* new_node = subnodes.back().get();
-    new_node->parent_node = this;
+    auto& nodes = root_->storage_->nodes;
+    nodes.push_back(SceneNode(this, hierarchy_->addNode(id_)));
+    SceneNode* new_node = &nodes.back();
+    subnodes.push_back(new_node);
 
     return new_node;
 }
 
-mat4 SceneNode::localTransformation()
+const vec3& SceneNode::position() const
 {
-    return getTranslation(pos) * getRotation(ori_x, ori_y, ori_z) * getScale(scale);
+    return hierarchy_->position(id_);
 }
 
-mat4 SceneNode::worldTransformation()
+const vec3& SceneNode::orientationX() const
 {
-    mat4 world_transf = localTransformation();
-    if (parent_node != nullptr) {
-        world_transf = parent_node->worldTransformation() * world_transf;
-    }
-    return world_transf;
+    return hierarchy_->orientationX(id_);
+}
+
+const vec3& SceneNode::orientationY() const
+{
+    return hierarchy_->orientationY(id_);
+}
+
+const vec3& SceneNode::orientationZ() const
+{
+    return hierarchy_->orientationZ(id_);
+}
+
+const vec3& SceneNode::scale() const
+{
+    return hierarchy_->scale(id_);
+}
+
+void SceneNode::setPosition(const vec3& pos)
+{
+    hierarchy_->setPosition(id_, pos);
+}
+
+void SceneNode::setOrientation(const vec3& ori_x,
+                               const vec3& ori_y,
+                               const vec3& ori_z)
+{
+    hierarchy_->setOrientation(id_, ori_x, ori_y, ori_z);
+}
+
+void SceneNode::setScale(const vec3& scale)
+{
+    hierarchy_->setScale(id_, scale);
+}
+
+const mat4& SceneNode::localTransformation()
+{
+    return hierarchy_->localTransformation(id_);
+}
+
+const mat4& SceneNode::worldTransformation()
+{
+    return hierarchy_->worldTransformation(id_);
+}
+
+const glm::mat3& SceneNode::worldNormalMatrix()
+{
+    return hierarchy_->worldNormalMatrix(id_);
+}
+
+TransformHierarchy& SceneNode::hierarchy() const
+{
+    return *hierarchy_;
+}
+
+TransformHierarchy::NodeId SceneNode::hierarchyId() const
+{
+    return id_;
 }
@@ -8,31 +8,79 @@
 #include <glm/mat4x4.hpp>
 
 #include "Mesh.hpp"
+#include "TransformHierarchy.hpp"
+
+// Storage of a whole tree, owned by its root.
+struct SceneTreeStorage;
 
 // SceneNode represents the node of a scene tree.
+//
+// A default constructed node is the root of a new tree. The root owns the storage of all its
+// descendants, and their transformations are kept in a flat TransformHierarchy, so a node is only
+// a lightweight handle to its transform data plus the links of the tree.
+// Local and world transformations are cached, and only recomputed after a node (or one of its
+// ancestors) has been moved, rotated or scaled.
 struct SceneNode
 {
 public:
 
     SceneNode();
     SceneNode(Mesh* p_mesh);
+    // Moving a node relinks its subnodes, and moving a root takes its whole tree along.
+    SceneNode(SceneNode&& node);
     ~SceneNode();
 
     // Create a new node.
     SceneNode* makeSubnode();
 
-    glm::mat4 localTransformation();
-    glm::mat4 worldTransformation();
+    // Transform getters.
+    const glm::vec3& position() const;
+    const glm::vec3& orientationX() const;
+    const glm::vec3& orientationY() const;
+    const glm::vec3& orientationZ() const;
+    const glm::vec3& scale() const;
+
+    // Transform setters. Changing a value invalidates the cached transformations of the subtree.
+    void setPosition(const glm::vec3& pos);
+    void setOrientation(const glm::vec3& ori_x,
+                        const glm::vec3& ori_y,
+                        const glm::vec3& ori_z);
+    void setScale(const glm::vec3& scale);
 
-    glm::vec3 pos;
-    glm::vec3 ori_x, ori_y, ori_z;
-    glm::vec3 scale;
+    const glm::mat4& localTransformation();
+    const glm::mat4& worldTransformation();
+    // Matrix transforming object space normals to world space.
+    const glm::mat3& worldNormalMatrix();
+
+    // Transform storage shared by the whole tree.
+    TransformHierarchy& hierarchy() const;
+    TransformHierarchy::NodeId hierarchyId() const;
 
 public:
 
-    std::vector<std::unique_ptr<SceneNode>> subnodes;
+    std::vector<SceneNode*> subnodes;
     SceneNode* parent_node;
     Mesh* mesh;
+    // Index of the node's material in the scene material list.
+    int material;
+    // Index of the node's texture in the scene texture list, or -1 for none.
+    int texture;
+    // Hint that the nodes of the subtree do not move relative to each other, so their meshes may
+    // be merged in a StaticBatch. The batch is still rebuilt if they do.
+    bool is_static;
+
+private:
+
+    // Create a subnode of `p_parent`.
+    SceneNode(SceneNode* p_parent, TransformHierarchy::NodeId id);
+
+    // Root of the tree this node belongs to.
+    SceneNode* root_;
+    TransformHierarchy* hierarchy_;
+    TransformHierarchy::NodeId id_;
+
+    // Storage of the tree, only set on the root.
+    std::unique_ptr<SceneTreeStorage> storage_;
 };
 
 #endif // SCENE_NODE_HPP
@@ -2,11 +2,15 @@
 
 #include <fstream>
 #include <iostream>
+#include <vector>
 
 #include <glad/glad.h>
 
+#include "GlState.hpp"
+
 using namespace std;
 using glm::vec3;
+using glm::mat3;
 using glm::mat4;
 
 // Load shader source from the disk.
@@ -26,65 +30,133 @@ static string loadShaderSource(const string& filename)
     return text;
 }
 
+// Insert `defines` after the first line of a shader source, which must be its #version directive.
+static string injectDefines(const string& source, const string& defines)
+{
+    if (defines.empty())
+        return source;
 
-// ShaderProgram class implementation.
+    const size_t line_end = source.find('\n');
+    if (line_end == string::npos)
+        return source + "\n" + defines;
 
-ShaderProgram::ShaderProgram(const string& vert_shader_path,
-                             const string& frag_shader_path):
-    id_{0}
+    string text = source;
+    text.insert(line_end + 1, defines);
+    return text;
+}
+
+
+// Compile a shader stage from a source file, reporting errors under `stage_name`.
+static unsigned int compileShader(GLenum type,
+                                  const string& path,
+                                  const string& defines,
+                                  const char* stage_name)
 {
-    // Load vertex shader source and compile it.
-    string vert_shader_string = loadShaderSource(vert_shader_path);
-    const char* vert_shader_src = vert_shader_string.c_str();
-    unsigned int vert_shader_id = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vert_shader_id, 1, &vert_shader_src, NULL);
-    glCompileShader(vert_shader_id);
-
-    // Load fragment shader source and compile it.
-    string frag_shader_string = loadShaderSource(frag_shader_path);
-    const char* frag_shader_src = frag_shader_string.c_str();
-    unsigned int frag_shader_id = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(frag_shader_id, 1, &frag_shader_src, NULL);
-    glCompileShader(frag_shader_id);
-
-    // Check if shaders compiled correctly.
-    {
-        int success;
-        char info_log[512];
-
-        glGetShaderiv(vert_shader_id, GL_COMPILE_STATUS, &success);
-        if (!success) {
-            glGetShaderInfoLog(vert_shader_id, 512, NULL, info_log);
-            cout << "Vertex shader compilation failed: \n" << info_log << endl;
-        }
-
-        glGetShaderiv(frag_shader_id, GL_COMPILE_STATUS, &success);
-        if (!success) {
-            glGetShaderInfoLog(frag_shader_id, 512, NULL, info_log);
-            cout << "Fragment shader compilation failed: \n" << info_log << endl;
-        }
+    string shader_string = injectDefines(loadShaderSource(path), defines);
+    const char* shader_src = shader_string.c_str();
+    unsigned int shader_id = glCreateShader(type);
+    glShaderSource(shader_id, 1, &shader_src, NULL);
+    glCompileShader(shader_id);
+
+    // Check if the shader compiled correctly.
+    int success;
+    char info_log[512];
+    glGetShaderiv(shader_id, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        glGetShaderInfoLog(shader_id, 512, NULL, info_log);
+        cout << stage_name << " shader compilation failed: \n" << info_log << endl;
     }
 
-    // Link shader program.
-    id_ = glCreateProgram();
-    glAttachShader(id_, vert_shader_id);
-    glAttachShader(id_, frag_shader_id);
-    glLinkProgram(id_);
+    return shader_id;
+}
+
+// Link compiled shaders in a new program, then delete them.
+static unsigned int linkProgram(const vector<unsigned int>& shader_ids)
+{
+    unsigned int program_id = glCreateProgram();
+    for (const auto shader_id : shader_ids)
+        glAttachShader(program_id, shader_id);
+    glLinkProgram(program_id);
 
     // Check if linking went well.
-    {
-        int success;
-        char info_log[512];
-        glGetProgramiv(id_, GL_LINK_STATUS, &success);
-        if (!success) {
-            glGetProgramInfoLog(id_, 512, NULL, info_log);
-            cout << "Shader program linking failed: \n" << info_log << endl;
-        }
+    int success;
+    char info_log[512];
+    glGetProgramiv(program_id, GL_LINK_STATUS, &success);
+    if (!success) {
+        glGetProgramInfoLog(program_id, 512, NULL, info_log);
+        cout << "Shader program linking failed: \n" << info_log << endl;
     }
 
     // Delete intermediate shader objects.
-    glDeleteShader(vert_shader_id);
-    glDeleteShader(frag_shader_id);
+    for (const auto shader_id : shader_ids)
+        glDeleteShader(shader_id);
+
+    return program_id;
+}
+
+
+// ShaderProgram class implementation.
+
+ShaderProgram::ShaderProgram(const string& vert_shader_path,
+                             const string& frag_shader_path,
+                             const string& defines):
+    id_{0}
+{
+    id_ = linkProgram({
+        compileShader(GL_VERTEX_SHADER, vert_shader_path, defines, "Vertex"),
+        compileShader(GL_FRAGMENT_SHADER, frag_shader_path, defines, "Fragment")
+    });
+
+    reflectUniforms();
+}
+
+ShaderProgram::ShaderProgram(const string& vert_shader_path,
+                             const string& tess_control_shader_path,
+                             const string& tess_eval_shader_path,
+                             const string& frag_shader_path,
+                             const string& defines):
+    id_{0}
+{
+    id_ = linkProgram({
+        compileShader(GL_VERTEX_SHADER, vert_shader_path, defines, "Vertex"),
+        compileShader(GL_TESS_CONTROL_SHADER, tess_control_shader_path, defines, "Tessellation control"),
+        compileShader(GL_TESS_EVALUATION_SHADER, tess_eval_shader_path, defines, "Tessellation evaluation"),
+        compileShader(GL_FRAGMENT_SHADER, frag_shader_path, defines, "Fragment")
+    });
+
+    reflectUniforms();
+}
+
+void ShaderProgram::reflectUniforms()
+{
+    char name[256];
+
+    int n_uniforms = 0;
+    glGetProgramiv(id_, GL_ACTIVE_UNIFORMS, &n_uniforms);
+    for (int i = 0; i < n_uniforms; ++i) {
+        int size;
+        GLenum type;
+        glGetActiveUniform(id_, i, sizeof(name), NULL, &size, &type, name);
+
+        // Members of uniform blocks have no location.
+        const int location = glGetUniformLocation(id_, name);
+        if (location == -1)
+            continue;
+
+        // Arrays are reported as "name[0]", but may also be set through "name".
+        string uniform_name(name);
+        const auto bracket = uniform_name.find('[');
+        if (bracket != string::npos)
+            uniform_locations_.emplace(uniform_name.substr(0, bracket), location);
+        uniform_locations_.emplace(move(uniform_name), location);
+    }
+
+    int n_blocks = 0;
+    glGetProgramiv(id_, GL_ACTIVE_UNIFORM_BLOCKS, &n_blocks);
+    for (int i = 0; i < n_blocks; ++i) {
+        glGetActiveUniformBlockName(id_, i, sizeof(name), NULL, name);
+        uniform_block_indices_.emplace(name, static_cast<unsigned int>(i));
+    }
 }
 
 unsigned int ShaderProgram::getId() const
@@ -94,14 +166,35 @@ unsigned int ShaderProgram::getId() const
 
 void ShaderProgram::use() const
 {
-    glUseProgram(id_);
+    GlState::useProgram(id_);
+}
+
+int ShaderProgram::uniformLocation(const char* uniform_name) const
+{
+    const auto it = uniform_locations_.find(uniform_name);
+    if (it == uniform_locations_.end()) {
+        cout << "Unable to locate uniform " << uniform_name << endl;
+        return -1;
+    }
+
+    return it->second;
+}
+
+void ShaderProgram::bindUniformBlock(const char* block_name, unsigned int binding) const
+{
+    const auto it = uniform_block_indices_.find(block_name);
+    if (it == uniform_block_indices_.end()) {
+        cout << "Unable to locate uniform block " << block_name << endl;
+        return;
+    }
+
+    glUniformBlockBinding(id_, it->second, binding);
 }
 
 void ShaderProgram::setUniform1i(const char* uniform_name, int value) const
 {
-    int uniform_location = glGetUniformLocation(id_, uniform_name);
+    int uniform_location = uniformLocation(uniform_name);
     if (uniform_location == -1) {
-        cout << "Unable to locate uniform " << uniform_name << endl;
         return;
     }
 
@@ -110,9 +203,8 @@ void ShaderProgram::setUniform1i(const char* uniform_name, int value) const
 
 void ShaderProgram::setUniform1f(const char* uniform_name, float value) const
 {
-    int uniform_location = glGetUniformLocation(id_, uniform_name);
+    int uniform_location = uniformLocation(uniform_name);
     if (uniform_location == -1) {
-        cout << "Unable to locate uniform " << uniform_name << endl;
         return;
     }
 
@@ -121,9 +213,8 @@ void ShaderProgram::setUniform1f(const char* uniform_name, float value) const
 
 void ShaderProgram::setUniformVec3f(const char* uniform_name, float x, float y, float z) const
 {
-    int uniform_location = glGetUniformLocation(id_, uniform_name);
+    int uniform_location = uniformLocation(uniform_name);
     if (uniform_location == -1) {
-        cout << "Unable to locate uniform " << uniform_name << endl;
         return;
     }
 
@@ -132,9 +223,8 @@ void ShaderProgram::setUniformVec3f(const char* uniform_name, float x, float y,
 
 void ShaderProgram::setUniformVec3f(const char* uniform_name, const vec3& vec) const
 {
-    int uniform_location = glGetUniformLocation(id_, uniform_name);
+    int uniform_location = uniformLocation(uniform_name);
     if (uniform_location == -1) {
-        cout << "Unable to locate uniform " << uniform_name << endl;
         return;
     }
 
@@ -143,22 +233,55 @@ void ShaderProgram::setUniformVec3f(const char* uniform_name, const vec3& vec) c
 
 void ShaderProgram::setUniformVec4f(const char* uniform_name, float x, float y, float z, float w) const
 {
-    int uniform_location = glGetUniformLocation(id_, uniform_name);
+    int uniform_location = uniformLocation(uniform_name);
     if (uniform_location == -1) {
-        cout << "Unable to locate uniform " << uniform_name << endl;
         return;
     }
 
     glUniform4f(uniform_location, x, y, z, w);
 }
 
+void ShaderProgram::setUniformMat3f(const char* uniform_name, const mat3& mat) const
+{
+    int uniform_location = uniformLocation(uniform_name);
+    if (uniform_location == -1) {
+        return;
+    }
+
+    glUniformMatrix3fv(uniform_location, 1, GL_FALSE, &mat[0][0]);
+}
+
 void ShaderProgram::setUniformMat4f(const char* uniform_name, const mat4& mat) const
 {
-    int uniform_location = glGetUniformLocation(id_, uniform_name);
+    int uniform_location = uniformLocation(uniform_name);
     if (uniform_location == -1) {
-        cout << "Unable to locate uniform " << uniform_name << endl;
         return;
     }
 
     glUniformMatrix4fv(uniform_location, 1, GL_FALSE, &mat[0][0]);
 }
+
+void ShaderProgram::setUniform1i(int location, int value)
+{
+    glUniform1i(location, value);
+}
+
+void ShaderProgram::setUniform1f(int location, float value)
+{
+    glUniform1f(location, value);
+}
+
+void ShaderProgram::setUniformVec3f(int location, const vec3& vec)
+{
+    glUniform3fv(location, 1, &vec[0]);
+}
+
+void ShaderProgram::setUniformMat3f(int location, const mat3& mat)
+{
+    glUniformMatrix3fv(location, 1, GL_FALSE, &mat[0][0]);
+}
+
+void ShaderProgram::setUniformMat4f(int location, const mat4& mat)
+{
+    glUniformMatrix4fv(location, 1, GL_FALSE, &mat[0][0]);
+}
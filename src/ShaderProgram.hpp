@@ -2,19 +2,40 @@
 #define SHADER_PROGRAM_HPP
 
 #include <string>
+#include <unordered_map>
 
 #include <glm/vec3.hpp>
+#include <glm/mat3x3.hpp>
 #include <glm/mat4x4.hpp>
 
 // Class abstraction of the OpenGL shader program object.
+// Active uniforms and uniform blocks are reflected once after linking, so setting a uniform by name
+// is a table lookup instead of a driver query. Hot paths can fetch a location once with
+// uniformLocation() and use the location based setters.
 class ShaderProgram
 {
 private:
     unsigned int id_;
 
+    // Locations of active uniforms, and indices of active uniform blocks, by name.
+    std::unordered_map<std::string, int> uniform_locations_;
+    std::unordered_map<std::string, unsigned int> uniform_block_indices_;
+
+    // Reflect active uniforms and uniform blocks of the linked program.
+    void reflectUniforms();
+
 public:
+    // `defines` is inserted right after the #version line of every shader, to build variants of
+    // the same sources, e.g. "#define INSTANCED\n".
+    ShaderProgram(const std::string& vert_shader_path,
+                  const std::string& frag_shader_path,
+                  const std::string& defines = "");
+    // Program with tessellation control and evaluation stages.
     ShaderProgram(const std::string& vert_shader_path,
-                  const std::string& frag_shader_path);
+                  const std::string& tess_control_shader_path,
+                  const std::string& tess_eval_shader_path,
+                  const std::string& frag_shader_path,
+                  const std::string& defines = "");
     ~ShaderProgram() = default;
 
     // Get shader program id.
@@ -22,13 +43,26 @@ public:
     // Use program shader.
     void use() const;
 
+    // Get the location of an active uniform, or -1 if there is no such uniform.
+    int uniformLocation(const char* uniform_name) const;
+    // Assign a uniform block to a uniform buffer binding point.
+    void bindUniformBlock(const char* block_name, unsigned int binding) const;
+
     // Uniform setters.
     void setUniform1i(const char* uniform_name, int value) const;
     void setUniform1f(const char* uniform_name, float value) const;
     void setUniformVec3f(const char* uniform_name, float x, float y, float z) const;
     void setUniformVec3f(const char* uniform_name, const glm::vec3& vec) const;
     void setUniformVec4f(const char* uniform_name, float x, float y, float z, float w) const;
+    void setUniformMat3f(const char* uniform_name, const glm::mat3& mat) const;
     void setUniformMat4f(const char* uniform_name, const glm::mat4& mat) const;
+
+    // Uniform setters by location, as returned by uniformLocation(). The program must be in use.
+    static void setUniform1i(int location, int value);
+    static void setUniform1f(int location, float value);
+    static void setUniformVec3f(int location, const glm::vec3& vec);
+    static void setUniformMat3f(int location, const glm::mat3& mat);
+    static void setUniformMat4f(int location, const glm::mat4& mat);
 };
 
 
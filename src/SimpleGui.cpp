@@ -44,6 +44,11 @@ void setupGuiFrame(GuiState& gui_state)
         ImGui::RadioButton("Perspective", &gui_state.is_perspective, 1);   ImGui::SameLine();
         ImGui::RadioButton("Orthogonal",  &gui_state.is_perspective, 0);
 
+        ImGui::Checkbox("Multi-draw indirect", &gui_state.multi_draw_indirect);
+        ImGui::Checkbox("Hardware tessellation", &gui_state.hardware_tessellation);
+        ImGui::Checkbox("Static batching", &gui_state.static_batching);
+        ImGui::Checkbox("Frustum culling", &gui_state.frustum_culling);
+
         ImGui::Text("Teapot textures:");
         ImGui::RadioButton("Wood",   &gui_state.teapot_tex, 1);   ImGui::SameLine();
         ImGui::RadioButton("Chess",  &gui_state.teapot_tex, 2);   ImGui::SameLine();
@@ -61,6 +66,10 @@ void setupGuiFrame(GuiState& gui_state)
         ImGui::Text("Average time per frame: %.3f ms (%.1f FPS)",
                     gui_state.time_per_frame,
                     1000.0 / gui_state.time_per_frame);
+        ImGui::Text("Draws: %d, state changes: %d", gui_state.draws, gui_state.state_changes);
+        ImGui::Text("CPU stalls on the GPU: %d", gui_state.stream_stalls);
+        ImGui::Text("Culled draws: %d", gui_state.culled_draws);
+        ImGui::Text("Redundant GL calls filtered: %d", gui_state.filtered_gl_calls);
 
         ImGui::End();
     }
@@ -17,8 +17,24 @@ struct GuiState
     float diffuse = 1.0f;
     float specular = 1.0f;
 
+    // Submit passes with multi-draw indirect.
+    bool multi_draw_indirect = true;
+    // Draw the teapot with tessellation shaders.
+    bool hardware_tessellation = false;
+    // Merge static subtrees when not drawing with multi-draw.
+    bool static_batching = true;
+    // Skip objects outside the camera and light frustums.
+    bool frustum_culling = true;
+
     // Teapot texture.
     int teapot_tex = 3;
+
+    // Render counters.
+    int draws = 0;
+    int state_changes = 0;
+    int stream_stalls = 0;
+    int culled_draws = 0;
+    int filtered_gl_calls = 0;
 };
 
 void setupImGui(GLFWwindow* window);
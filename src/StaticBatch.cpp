@@ -0,0 +1,137 @@
+#include "StaticBatch.hpp"
+
+#include <cassert>
+
+#include <glm/glm.hpp>
+
+#include "SceneNode.hpp"
+
+using namespace std;
+using glm::vec3;
+using glm::vec4;
+using glm::mat3;
+using glm::mat4;
+
+// Find the shared material and texture of the meshes below `node`, and count them.
+static bool findSharedLook(SceneNode* node, int& material, int& texture, int& mesh_count)
+{
+    for (SceneNode* subnode : node->subnodes) {
+        if (subnode->mesh != nullptr) {
+            if (subnode->mesh->vertices.empty())
+                return false;
+            if (mesh_count == 0) {
+                material = subnode->material;
+                texture = subnode->texture;
+            }
+            else if (subnode->material != material || subnode->texture != texture) {
+                return false;
+            }
+            mesh_count++;
+        }
+        if (!findSharedLook(subnode, material, texture, mesh_count))
+            return false;
+    }
+    return true;
+}
+
+bool StaticBatch::canBatch(SceneNode* root)
+{
+    int material = 0;
+    int texture = -1;
+    int mesh_count = 0;
+    return root->mesh == nullptr
+           && findSharedLook(root, material, texture, mesh_count)
+           && mesh_count >= 2;
+}
+
+StaticBatch::StaticBatch(SceneNode* root, const MeshUploadOptions& options):
+    root_(root),
+    options_(options),
+    members_(),
+    current_(),
+    mesh_()
+{
+    assert(canBatch(root));
+
+    collectMembers(root_, members_);
+    build();
+}
+
+bool StaticBatch::update()
+{
+    current_.clear();
+    collectMembers(root_, current_);
+
+    bool is_outdated = current_.size() != members_.size();
+    for (size_t i = 0; i < current_.size() && !is_outdated; ++i) {
+        const Member& a = current_[i];
+        const Member& b = members_[i];
+        is_outdated = a.node != b.node || a.mesh != b.mesh || a.local != b.local
+                      || a.material != b.material || a.texture != b.texture;
+    }
+    if (!is_outdated)
+        return false;
+
+    members_.swap(current_);
+    build();
+    return true;
+}
+
+SceneNode* StaticBatch::root() const
+{
+    return root_;
+}
+
+Mesh* StaticBatch::mesh()
+{
+    return &mesh_;
+}
+
+int StaticBatch::material() const
+{
+    return members_.empty() ? 0 : members_.front().material;
+}
+
+int StaticBatch::texture() const
+{
+    return members_.empty() ? -1 : members_.front().texture;
+}
+
+void StaticBatch::collectMembers(SceneNode* node, vector<Member>& members)
+{
+    for (SceneNode* subnode : node->subnodes) {
+        members.push_back({subnode, subnode->mesh, subnode->localTransformation(),
+                           subnode->material, subnode->texture});
+        collectMembers(subnode, members);
+    }
+}
+
+void StaticBatch::build()
+{
+    // The members are listed depth first, so the transformation to the root space of each one is
+    // that of its parent, found on a stack of ancestors, times its own.
+    vector<pair<SceneNode*, mat4>> ancestors{{root_, mat4(1.0f)}};
+
+    mesh_ = Mesh();
+    for (const Member& member : members_) {
+        while (ancestors.back().first != member.node->parent_node)
+            ancestors.pop_back();
+        const mat4 to_root = ancestors.back().second * member.local;
+        ancestors.emplace_back(member.node, to_root);
+
+        if (member.mesh == nullptr)
+            continue;
+
+        // Append the mesh, then move its vertices to the root space.
+        const size_t first_vertex = mesh_.vertices.size();
+        mesh_.extend(*member.mesh);
+        const mat3 normal_matrix = glm::transpose(glm::inverse(mat3(to_root)));
+        for (size_t i = first_vertex; i < mesh_.vertices.size(); ++i) {
+            Vertex& v = mesh_.vertices[i];
+            v.pos = vec3(to_root * vec4(v.pos, 1.0f));
+            v.normal = glm::normalize(normal_matrix * v.normal);
+        }
+    }
+
+    mesh_.pushToGpu(options_);
+}
@@ -0,0 +1,62 @@
+#ifndef STATIC_BATCH_HPP
+#define STATIC_BATCH_HPP
+
+#include <vector>
+
+#include <glm/mat4x4.hpp>
+
+#include "Mesh.hpp"
+
+struct SceneNode;
+
+// Meshes of a static subtree, sharing material and texture, merged into a single mesh.
+//
+// Vertices are transformed to the space of the subtree root, so the whole subtree is drawn with
+// one call and the world transformation of its root: the root itself can still move freely. The
+// merged mesh is rebuilt whenever a node below the root changes its local transformation, mesh,
+// material or texture, or when nodes are added.
+class StaticBatch
+{
+public:
+
+    // Whether the subtree of `root` can be batched: it must hold at least two meshes, all with
+    // the same material and texture, and with CPU copies of their vertices.
+    static bool canBatch(SceneNode* root);
+
+    StaticBatch(SceneNode* root, const MeshUploadOptions& options);
+
+    // Rebuild the merged mesh if the subtree changed since it was built. Returns whether it was
+    // rebuilt.
+    bool update();
+
+    SceneNode* root() const;
+    Mesh* mesh();
+    int material() const;
+    int texture() const;
+
+private:
+
+    // State of a node below the root, as seen when the mesh was built.
+    struct Member
+    {
+        SceneNode* node;
+        Mesh* mesh;
+        glm::mat4 local;
+        int material;
+        int texture;
+    };
+
+    // Append the state of the nodes below `node` to `members`, in depth first order.
+    static void collectMembers(SceneNode* node, std::vector<Member>& members);
+    // Merge the meshes of the members.
+    void build();
+
+    SceneNode* root_;
+    MeshUploadOptions options_;
+    std::vector<Member> members_;
+    // Scratch list compared with `members_` on each update.
+    std::vector<Member> current_;
+    Mesh mesh_;
+};
+
+#endif // STATIC_BATCH_HPP
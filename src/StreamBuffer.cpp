@@ -0,0 +1,152 @@
+#include "StreamBuffer.hpp"
+
+#include <cassert>
+
+#include <glad/glad.h>
+
+using namespace std;
+
+// Time the CPU waits for a fence at once, in nanoseconds, before checking it again.
+static const GLuint64 FENCE_TIMEOUT = 1000000;
+
+// Buffer target used to allocate and map the storage, so other bindings are left untouched.
+static const GLenum STORAGE_TARGET = GL_COPY_WRITE_BUFFER;
+
+StreamBuffer::StreamBuffer(size_t frame_capacity):
+    id_(0),
+    frame_capacity_(frame_capacity),
+    is_persistent_(isPersistentMappingSupported()),
+    frame_(FRAME_COUNT - 1),
+    frame_used_(0),
+    mapped_(nullptr),
+    fences_{}
+{
+    assert(frame_capacity > 0);
+    allocateStorage();
+}
+
+StreamBuffer::~StreamBuffer()
+{
+    for (void* fence : fences_) {
+        if (fence != nullptr)
+            glDeleteSync(static_cast<GLsync>(fence));
+    }
+    // Deleting the buffer also unmaps it.
+    glDeleteBuffers(1, &id_);
+}
+
+bool StreamBuffer::beginFrame(size_t frame_size)
+{
+    assert(is_persistent_ || mapped_ == nullptr);
+
+    bool has_waited = false;
+    if (frame_size > frame_capacity_) {
+        // Rare: the frames still in flight read the old storage, so let them complete.
+        for (int frame = 0; frame < FRAME_COUNT; ++frame)
+            has_waited = waitForRegion(frame) || has_waited;
+        while (frame_capacity_ < frame_size)
+            frame_capacity_ *= 2;
+        glDeleteBuffers(1, &id_);
+        allocateStorage();
+    }
+
+    frame_ = (frame_ + 1) % FRAME_COUNT;
+    frame_used_ = 0;
+    has_waited = waitForRegion(frame_) || has_waited;
+
+    if (!is_persistent_) {
+        // The fence guarantees the GPU is done with the region.
+        glBindBuffer(STORAGE_TARGET, id_);
+        mapped_ = static_cast<char*>(glMapBufferRange(STORAGE_TARGET,
+                                                      frame_ * frame_capacity_,
+                                                      frame_capacity_,
+                                                      GL_MAP_WRITE_BIT
+                                                      | GL_MAP_UNSYNCHRONIZED_BIT
+                                                      | GL_MAP_INVALIDATE_RANGE_BIT));
+        glBindBuffer(STORAGE_TARGET, 0);
+        assert(mapped_ != nullptr);
+    }
+    return has_waited;
+}
+
+StreamBuffer::Range StreamBuffer::allocate(size_t size, size_t alignment)
+{
+    assert(alignment > 0);
+
+    const size_t start = (frame_used_ + alignment - 1) / alignment * alignment;
+    assert(start + size <= frame_capacity_);
+    frame_used_ = start + size;
+
+    const size_t offset = frame_ * frame_capacity_ + start;
+    char* data = is_persistent_ ? mapped_ + offset : mapped_ + start;
+    return {data, offset};
+}
+
+void StreamBuffer::endWrites()
+{
+    // Coherent mappings need no flush.
+    if (is_persistent_)
+        return;
+
+    glBindBuffer(STORAGE_TARGET, id_);
+    glUnmapBuffer(STORAGE_TARGET);
+    glBindBuffer(STORAGE_TARGET, 0);
+    mapped_ = nullptr;
+}
+
+void StreamBuffer::endFrame()
+{
+    assert(fences_[frame_] == nullptr);
+    fences_[frame_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+unsigned int StreamBuffer::getId() const
+{
+    return id_;
+}
+
+size_t StreamBuffer::frameCapacity() const
+{
+    return frame_capacity_;
+}
+
+bool StreamBuffer::isPersistentMappingSupported()
+{
+    return GLAD_GL_VERSION_4_4 != 0;
+}
+
+void StreamBuffer::allocateStorage()
+{
+    const size_t size = FRAME_COUNT * frame_capacity_;
+
+    glGenBuffers(1, &id_);
+    glBindBuffer(STORAGE_TARGET, id_);
+    if (is_persistent_) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(STORAGE_TARGET, size, NULL, flags);
+        mapped_ = static_cast<char*>(glMapBufferRange(STORAGE_TARGET, 0, size, flags));
+        assert(mapped_ != nullptr);
+    }
+    else {
+        glBufferData(STORAGE_TARGET, size, NULL, GL_STREAM_DRAW);
+    }
+    glBindBuffer(STORAGE_TARGET, 0);
+}
+
+bool StreamBuffer::waitForRegion(int frame)
+{
+    GLsync fence = static_cast<GLsync>(fences_[frame]);
+    if (fence == nullptr)
+        return false;
+
+    // Flush on the first check only, so the fence is guaranteed to be signaled eventually.
+    GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    const bool has_waited = status == GL_TIMEOUT_EXPIRED;
+    while (status == GL_TIMEOUT_EXPIRED)
+        status = glClientWaitSync(fence, 0, FENCE_TIMEOUT);
+    assert(status != GL_WAIT_FAILED);
+
+    glDeleteSync(fence);
+    fences_[frame] = nullptr;
+    return has_waited;
+}
@@ -0,0 +1,73 @@
+#ifndef STREAM_BUFFER_HPP
+#define STREAM_BUFFER_HPP
+
+#include <cstddef>
+
+// Buffer object split in a ring of per frame regions, for data rewritten every frame: the CPU
+// fills the region of the current frame while the GPU still reads the regions of the previous
+// ones. Each region is guarded by a fence, so it is only rewritten once the draws reading it have
+// completed, and the buffer is neither orphaned nor reallocated from frame to frame.
+//
+// With OpenGL 4.4, the buffer is mapped once and for all, persistently and coherently. Otherwise,
+// the region of the frame is mapped without synchronization from beginFrame() to endWrites(), the
+// fences making that safe.
+class StreamBuffer
+{
+public:
+
+    // Number of frames in flight.
+    static constexpr int FRAME_COUNT = 3;
+
+    // Allocation in the region of the current frame.
+    struct Range
+    {
+        // Where to write the data, until endWrites().
+        void* data;
+        // Offset in the buffer, to bind or read the data from.
+        size_t offset;
+    };
+
+    // Allocate `frame_capacity` bytes per frame.
+    explicit StreamBuffer(size_t frame_capacity);
+    ~StreamBuffer();
+
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    // Move to the region of the next frame, waiting for the GPU to release it if needed, and map
+    // it. A frame needing more than the capacity grows the buffer, after the GPU is done with
+    // every region. Returns whether the CPU had to wait.
+    bool beginFrame(size_t frame_size);
+    // Reserve `size` bytes in the region of the frame, at a multiple of `alignment`.
+    Range allocate(size_t size, size_t alignment);
+    // Make the data written in the frame visible to the GPU. Must be called before drawing.
+    void endWrites();
+    // Fence the commands reading the region of the frame, once they are all submitted.
+    void endFrame();
+
+    unsigned int getId() const;
+    size_t frameCapacity() const;
+
+    // Whether the buffer is persistently mapped.
+    static bool isPersistentMappingSupported();
+
+private:
+
+    unsigned int id_;
+    size_t frame_capacity_;
+    bool is_persistent_;
+    // Region of the current frame, and amount of it already allocated.
+    int frame_;
+    size_t frame_used_;
+    // Start of the mapped memory: the whole buffer if persistent, the frame region otherwise.
+    char* mapped_;
+    // Fence (GLsync) of the last commands reading each region, or null.
+    void* fences_[FRAME_COUNT];
+
+    // Create and map the storage of the buffer.
+    void allocateStorage();
+    // Wait for the commands reading a region to complete. Returns whether the CPU had to wait.
+    bool waitForRegion(int frame);
+};
+
+#endif // STREAM_BUFFER_HPP
@@ -1,466 +1,507 @@
 #include "Teapot.hpp"
 
+#include <array>
 #include <vector>
 
 #include <glm/vec3.hpp>
 
 #include "Geometry.hpp"
+#include "MeshOptimizer.hpp"
+#include "Parallel.hpp"
 
 using glm::vec3;
 using namespace std;
 
-// Teapot parts, according to the original dataset from "The Origins of the Teapot", 1987.
-enum class TeapotParts
-{
-    RIM,
-    BODY,
-    HANDLE,
-    SPOUT,
-    LID,
-    BOTTOM
-};
-
-// Functions to retrieve the teapot's original dataset.
-static vector<vec3> teapotVertices();
-static vector<unsigned int> teapotPatch(TeapotParts part);
-
 // The original teapot dataset uses the same patch size of 16.
 const int PATCH_ROWS = 4;
 const int PATCH_COLS = 4;
 const int PATCH_SIZE = PATCH_ROWS * PATCH_COLS;
 
-Mesh createTeapot(float sample_density)
-{
-    Mesh mesh;
-    const auto teapot_vertices = teapotVertices();
-    const vector<TeapotParts> teapot_parts = {
-        TeapotParts::RIM,
-        TeapotParts::BODY,
-        TeapotParts::HANDLE,
-        TeapotParts::SPOUT,
-        TeapotParts::LID,
-        TeapotParts::BOTTOM
-    };
+// Teapot dataset from "The Origins of the Teapot", 1987, with its parts listed in order: rim, body,
+// handle, spout, lid and bottom. Only the tables below are part of the program, everything else is
+// derived from them by the compiler.
 
-    // Populate the mesh with all the teapot parts.
-    for (const auto& part : teapot_parts) {
-        const auto part_indices = teapotPatch(part);
-        assert(part_indices.size() % PATCH_SIZE == 0);
+// Control points of the original dataset.
+static constexpr array<array<float, 3>, TEAPOT_CONTROL_POINT_COUNT> TEAPOT_DATASET_POINTS = {{
+    {1.4, 0.0, 2.4},
+    {1.4, -0.784, 2.4},
+    {0.784, -1.4, 2.4},
+    {0.0, -1.4, 2.4},
+    {1.3376, 0.0, 2.63125},
+    {1.3376, -0.749, 2.53125},
+    {0.749, -1.3375, 2.53125},
+    {0.0, -1.3375, 2.53125},
+    {1.4375, 0.0, 2.53125},
+    {1.4375, -0.805, 2.53125},
+    {0.805, -1.4375, 2.53125},
+    {0.0, -1.4375, 2.53125},
+    {1.5, 0.0, 2.4},
+    {1.5, -0.84, 2.4},
+    {0.84, -1.5, 2.4},
+    {0.0, -1.5, 2.4},
+    {-0.784, -1.4, 2.4},
+    {-1.4, -0.784, 2.4},
+    {-1.4, 0.0, 2.4},
+    {-0.749, -1.3375, 2.53125},
+    {-1.3376, -0.749, 2.53125},
+    {-1.3375, 0.0, 2.53125},
+    {-0.805, -1.4375, 2.53125},
+    {-1.4375, -0.805, 2.53125},
+    {-1.4375, 0.0, 2.53125},
+    {-0.84, -1.5, 2.4},
+    {-1.5, -0.84, 2.4},
+    {-1.5, 0.0, 2.4},
+    {-1.4, 0.784, 2.4},
+    {-0.784, 1.4, 2.4},
+    {0.0, 1.4, 2.4},
+    {-1.3375, 0.749, 2.53125},
+    {-0.749, 1.3375, 2.53125},
+    {0.0, 1.3375, 2.53125},
+    {-1.4375, 0.805, 2.53125},
+    {-0.805, 1.4375, 2.53125},
+    {0.0, 1.4375, 2.53125},
+    {-1.5, 0.84, 2.4},
+    {-0.84, 1.5, 2.4},
+    {0.0, 1.5, 2.4},
+    {0.784, 1.4, 2.4},
+    {1.4, 0.784, 2.4},
+    {0.749, 1.3375, 2.53125},
+    {1.3375, 0.749, 2.53126},
+    {0.805, 1.4375, 2.53126},
+    {1.4375, 0.805, 2.53125},
+    {0.84, 1.5, 2.4},
+    {1.5, 0.84, 2.4},
+    {1.76, 0.0, 1.875},
+    {1.75, -0.98, 1.875},
+    {0.98, -1.75, 1.875},
+    {0.0, -1.75, 1.875},
+    {2.0, 0.0, 1.35},
+    {2.0, -1.12, 1.35},
+    {1.12, -2.0, 1.35},
+    {0.0, -2.0, 1.35},
+    {2.0, 0.0, 0.9},
+    {2.0, -1.12, 0.9},
+    {1.12, -2.0, 0.9},
+    {0.0, -2.0, 0.9},
+    {-0.98, -1.75, 1.875},
+    {-1.75, -0.98, 1.875},
+    {-1.75, 0.0, 1.875},
+    {-1.12, -2.0, 1.35},
+    {-2.0, -1.12, 1.35},
+    {-2.0, 0.0, 1.35},
+    {-1.12, -2.0, 0.9},
+    {-2.0, -1.12, 0.9},
+    {-2.0, 0.0, 0.9},
+    {-1.75, 0.98, 1.875},
+    {-0.98, 1.75, 1.875},
+    {0.0, 1.75, 1.875},
+    {-2.0, 1.12, 1.35},
+    {-1.12, 2.0, 1.35},
+    {0.0, 2.0, 1.35},
+    {-2.0, 1.12, 0.9},
+    {-1.12, 2.0, 0.9},
+    {0.0, 2.0, 0.9},
+    {0.98, 1.75, 1.875},
+    {1.75, 0.98, 1.875},
+    {1.12, 2.0, 1.35},
+    {2.0, 1.12, 1.35},
+    {1.12, 2.0, 0.9},
+    {2.0, 1.12, 0.9},
+    {2.0, 0.0, 0.45},
+    {2.0, -1.12, 0.45},
+    {1.12, -2.0, 0.45},
+    {0.0, -2.0, 0.45},
+    {1.5, 0.0, 0.225},
+    {1.5, -0.84, 0.225},
+    {0.84, -1.5, 0.225},
+    {0.0, -1.5, 0.225},
+    {1.5, 0.0, 0.15},
+    {1.5, -0.84, 0.15},
+    {0.84, -1.6, 0.15},
+    {0.0, -1.5, 0.15},
+    {-1.12, -2.0, 0.45},
+    {-2.0, -1.12, 0.45},
+    {-2.0, 0.0, 0.45},
+    {-0.84, -1.5, 0.225},
+    {-1.5, -0.84, 0.225},
+    {-1.5, 0.0, 0.225},
+    {-0.84, -1.5, 0.15},
+    {-1.5, -0.84, 0.15},
+    {-1.5, 0.0, 0.15},
+    {-2.0, 1.12, 0.45},
+    {-1.12, 2.0, 0.45},
+    {0.0, 2.0, 0.45},
+    {-1.5, 0.84, 0.225},
+    {-0.84, 1.5, 0.225},
+    {0.0, 1.5, 0.225},
+    {-1.5, 0.84, 0.15},
+    {-0.84, 1.5, 0.15},
+    {0.0, 1.5, 0.15},
+    {1.12, 2.0, 0.45},
+    {2.0, 1.12, 0.45},
+    {0.84, 1.5, 0.225},
+    {1.5, 0.84, 0.225},
+    {0.84, 1.5, 0.15},
+    {1.5, 0.84, 0.15},
+    {-1.6, 0.0, 2.025},
+    {-1.6, -0.3, 2.025},
+    {-1.5, -0.3, 2.25},
+    {-1.5, 0.0, 2.25},
+    {-2.3, 0.0, 2.025},
+    {-2.3, -0.3, 2.025},
+    {-2.5, -0.3, 2.25},
+    {-2.5, 0.0, 2.25},
+    {-2.7, 0.0, 2.025},
+    {-2.7, -0.3, 2.025},
+    {-3.0, -0.3, 2.25},
+    {-3.0, 0.0, 2.25},
+    {-2.7, 0.0, 1.8},
+    {-2.7, -0.3, 1.8},
+    {-3.0, -0.3, 1.8},
+    {-3.0, 0.0, 1.8},
+    {-1.5, 0.3, 2.25},
+    {-1.6, 0.3, 2.025},
+    {-2.5, 0.3, 2.25},
+    {-2.3, 0.3, 2.025},
+    {-3.0, 0.3, 2.25},
+    {-2.7, 0.3, 2.025},
+    {-3.0, 0.3, 1.8},
+    {-2.7, 0.3, 1.8},
+    {-2.7, 0.0, 1.575},
+    {-2.7, -0.3, 1.575},
+    {-3.0, -0.3, 1.35},
+    {-3.0, 0.0, 1.35},
+    {-2.5, 0.0, 1.125},
+    {-2.5, -0.3, 1.125},
+    {-2.65, -0.3, 0.9375},
+    {-2.65, 0.0, 0.9375},
+    {-2.0, -0.3, 0.9},
+    {-1.9, -0.3, 0.6},
+    {-1.9, 0.0, 0.6},
+    {-3.0, 0.3, 1.35},
+    {-2.7, 0.3, 1.575},
+    {-2.65, 0.3, 0.9375},
+    {-2.5, 0.3, 1.125},
+    {-1.9, 0.3, 0.6},
+    {-2.0, 0.3, 0.9},
+    {1.7, 0.0, 1.425},
+    {1.7, -0.66, 1.425},
+    {1.7, -0.66, 0.6},
+    {1.7, 0.0, 0.6},
+    {2.6, 0.0, 1.425},
+    {2.6, -0.66, 1.425},
+    {3.1, -0.66, 0.825},
+    {3.1, 0.0, 0.825},
+    {2.3, 0.0, 2.1},
+    {2.3, -0.25, 2.1},
+    {2.4, -0.25, 2.025},
+    {2.4, 0.0, 2.025},
+    {2.7, 0.0, 2.4},
+    {2.7, -0.25, 2.4},
+    {3.3, -0.25, 2.4},
+    {3.3, 0.0, 2.4},
+    {1.7, 0.66, 0.6},
+    {1.7, 0.66, 1.425},
+    {3.1, 0.66, 0.825},
+    {2.6, 0.66, 1.425},
+    {2.4, 0.25, 2.025},
+    {2.3, 0.25, 2.1},
+    {3.3, 0.25, 2.4},
+    {2.7, 0.25, 2.4},
+    {2.8, 0.0, 2.475},
+    {2.8, -0.25, 2.475},
+    {3.525, -0.25, 2.49375},
+    {3.525, 0.0, 2.49375},
+    {2.9, 0.0, 2.475},
+    {2.9, -0.15, 2.475},
+    {3.45, -0.15, 2.5125},
+    {3.45, 0.0, 2.5125},
+    {2.8, 0.0, 2.4},
+    {2.8, -0.15, 2.4},
+    {3.2, -0.15, 2.4},
+    {3.2, 0.0, 2.4},
+    {3.525, 0.25, 2.49375},
+    {2.8, 0.25, 2.475},
+    {3.45, 0.15, 2.5125},
+    {2.9, 0.15, 2.475},
+    {3.2, 0.15, 2.4},
+    {2.8, 0.15, 2.4},
+    {0.0, 0.0, 3.15},
+    {0.0, -0.002, 3.15},
+    {0.002, 0.0, 3.15},
+    {0.8, 0.0, 3.15},
+    {0.8, -0.45, 3.15},
+    {0.45, -0.8, 3.15},
+    {0.0, -0.8, 3.15},
+    {0.0, 0.0, 2.85},
+    {0.2, 0.0, 2.7},
+    {0.2, -0.112, 2.7},
+    {0.112, -0.2, 2.7},
+    {0.0, -0.2, 2.7},
+    {-0.002, 0.0, 3.15},
+    {-0.45, -0.8, 3.15},
+    {-0.8, -0.45, 3.15},
+    {-0.8, 0.0, 3.15},
+    {-0.112, -0.2, 2.7},
+    {-0.2, -0.112, 2.7},
+    {-0.2, 0.0, 2.7},
+    {0.0, 0.002, 3.15},
+    {-0.8, 0.45, 3.15},
+    {-0.45, 0.8, 3.15},
+    {0.0, 0.8, 3.15},
+    {-0.2, 0.112, 2.7},
+    {-0.112, 0.2, 2.7},
+    {0.0, 0.2, 2.7},
+    {0.45, 0.8, 3.15},
+    {0.8, 0.45, 3.15},
+    {0.112, 0.2, 2.7},
+    {0.2, 0.112, 2.7},
+    {0.4, 0.0, 2.55},
+    {0.4, -0.224, 2.55},
+    {0.224, -0.4, 2.55},
+    {0.0, -0.4, 2.55},
+    {1.3, 0.0, 2.55},
+    {1.3, -0.728, 2.55},
+    {0.728, -1.3, 2.55},
+    {0.0, -1.3, 2.55},
+    {1.3, 0.0, 2.4},
+    {1.3, -0.728, 2.4},
+    {0.728, -1.3, 2.4},
+    {0.0, -1.3, 2.4},
+    {-0.224, -0.4, 2.55},
+    {-0.4, -0.224, 2.55},
+    {-0.4, 0.0, 2.55},
+    {-0.728, -1.3, 2.55},
+    {-1.3, -0.728, 2.55},
+    {-1.3, 0.0, 2.55},
+    {-0.728, -1.3, 2.4},
+    {-1.3, -0.728, 2.4},
+    {-1.3, 0.0, 2.4},
+    {-0.4, 0.224, 2.55},
+    {-0.224, 0.4, 2.55},
+    {0.0, 0.4, 2.55},
+    {-1.3, 0.728, 2.55},
+    {-0.728, 1.3, 2.55},
+    {0.0, 1.3, 2.55},
+    {-1.3, 0.728, 2.4},
+    {-0.728, 1.3, 2.4},
+    {0.0, 1.3, 2.4},
+    {0.224, 0.4, 2.55},
+    {0.4, 0.224, 2.55},
+    {0.728, 1.3, 2.55},
+    {1.3, 0.728, 2.55},
+    {0.728, 1.3, 2.4},
+    {1.3, 0.728, 2.4},
+    {0.0, 0.0, 0.0},
+    {1.5, 0.0, 0.15},
+    {1.5, 0.84, 0.15},
+    {0.84, 1.5, 0.15},
+    {0.0, 1.5, 0.15},
+    {1.5, 0.0, 0.075},
+    {1.5, 0.84, 0.075},
+    {0.84, 1.5, 0.075},
+    {0.0, 1.5, 0.075},
+    {1.425, 0.0, 0.0},
+    {1.425, 0.798, 0.0},
+    {0.798, 1.425, 0.0},
+    {0.0, 1.425, 0.0},
+    {-0.84, 1.5, 0.15},
+    {-1.5, 0.84, 0.15},
+    {-1.5, 0.0, 0.15},
+    {-0.84, 1.5, 0.075},
+    {-1.5, 0.84, 0.075},
+    {-1.5, 0.0, 0.075},
+    {-0.798, 1.425, 0.0},
+    {-1.425, 0.798, 0.0},
+    {-1.425, 0.0, 0.0},
+    {-1.5, -0.84, 0.15},
+    {-0.84, -1.5, 0.15},
+    {0.0, -1.5, 0.15},
+    {-1.5, -0.84, 0.075},
+    {-0.84, -1.5, 0.075},
+    {0.0, -1.5, 0.075},
+    {-1.425, -0.798, 0.0},
+    {-0.798, -1.425, 0.0},
+    {0.0, -1.425, 0.0},
+    {0.84, -1.5, 0.15},
+    {1.5, -0.84, 0.15},
+    {0.84, -1.5, 0.075},
+    {1.5, -0.84, 0.075},
+    {0.798, -1.425, 0.0},
+    {1.425, -0.798, 0.0}
+}};
 
-        // Reuse te control points buffer for each part.
-        vector<vec3> control_points;
-        control_points.reserve(PATCH_SIZE);
-        // Number of patches.
-        const auto n_patches = part_indices.size() / PATCH_SIZE;
+// Patches of the original dataset, whose indices start at 1.
+static constexpr unsigned int TEAPOT_DATASET_PATCHES[TEAPOT_PATCH_COUNT][PATCH_SIZE] = {
+    // Rim.
+    {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16},
+    {4, 17, 18, 19, 8, 20, 21, 22, 12, 23, 24, 25, 16, 26, 27, 28},
+    {19, 29, 30, 31, 22, 32, 33, 34, 25, 35, 36, 37, 28, 38, 39, 40},
+    {31, 41, 42, 1, 34, 43, 44, 5, 37, 45, 46, 9, 40, 47, 48, 13},
+    // Body.
+    {13, 14, 15, 16, 49, 50, 51, 52, 53, 54, 55, 56, 57, 58, 59, 60},
+    {16, 26, 27, 28, 52, 61, 62, 63, 56, 64, 65, 66, 60, 67, 68, 69},
+    {28, 38, 39, 40, 63, 70, 71, 72, 66, 73, 74, 75, 69, 76, 77, 78},
+    {40, 47, 48, 13, 72, 79, 80, 49, 75, 81, 82, 53, 78, 83, 84, 57},
+    {57, 58, 59, 60, 85, 86, 87, 88, 89, 90, 91, 92, 93, 94, 95, 96},
+    {60, 67, 68, 69, 88, 97, 98, 99, 92, 100, 101, 102, 96, 103, 104, 105},
+    {69, 76, 77, 78, 99, 106, 107, 108, 102, 109, 110, 111, 105, 112, 113, 114},
+    {78, 83, 84, 57, 108, 115, 116, 85, 111, 117, 118, 89, 114, 119, 120, 93},
+    // Handle.
+    {121, 122, 123, 124, 125, 126, 127, 128, 129, 130, 131, 132, 133, 134, 135, 136},
+    {124, 137, 138, 121, 128, 139, 140, 125, 132, 141, 142, 129, 136, 143, 144, 133},
+    {133, 134, 135, 136, 145, 146, 147, 148, 149, 150, 151, 152, 69, 153, 154, 155},
+    {136, 143, 144, 133, 148, 156, 157, 145, 152, 158, 159, 149, 155, 160, 161, 69},
+    // Spout.
+    {162, 163, 164, 165, 166, 167, 168, 169, 170, 171, 172, 173, 174, 175, 176, 177},
+    {165, 178, 179, 162, 169, 180, 181, 166, 173, 182, 183, 170, 177, 184, 185, 174},
+    {174, 175, 176, 177, 186, 187, 188, 189, 190, 191, 192, 193, 194, 195, 196, 197},
+    {177, 184, 185, 174, 189, 198, 199, 186, 193, 200, 201, 190, 197, 202, 203, 194},
+    // Lid.
+    {204, 204, 204, 204, 207, 208, 209, 210, 211, 211, 211, 211, 212, 213, 214, 215},
+    {204, 204, 204, 204, 210, 217, 218, 219, 211, 211, 211, 211, 215, 220, 221, 222},
+    {204, 204, 204, 204, 219, 224, 225, 226, 211, 211, 211, 211, 222, 227, 228, 229},
+    {204, 204, 204, 204, 226, 230, 231, 207, 211, 211, 211, 211, 229, 232, 233, 212},
+    {212, 213, 214, 215, 234, 235, 236, 237, 238, 239, 240, 241, 242, 243, 244, 245},
+    {215, 220, 221, 222, 237, 246, 247, 248, 241, 249, 250, 251, 245, 252, 253, 254},
+    {222, 227, 228, 229, 248, 255, 256, 257, 251, 258, 259, 260, 254, 261, 262, 263},
+    {229, 232, 233, 212, 257, 264, 265, 234, 260, 266, 267, 238, 263, 268, 269, 242},
+    // Bottom.
+    {270, 270, 270, 270, 279, 280, 281, 282, 275, 276, 277, 278, 271, 272, 273, 274},
+    {270, 270, 270, 270, 282, 289, 290, 291, 278, 286, 287, 288, 274, 283, 284, 285},
+    {270, 270, 270, 270, 291, 298, 299, 300, 288, 295, 296, 297, 285, 292, 293, 294},
+    {270, 270, 270, 270, 300, 305, 306, 279, 297, 303, 304, 275, 294, 301, 302, 271}
+};
 
-        // For each patch:
-        // 1. Get its control points;
-        // 2. Sample the Bezier surface;
-        // 3. Triangulate it and append it to the mesh.
-        for (int patch = 0; patch < n_patches; ++patch) {
-            const int first_index = patch * PATCH_SIZE;
-            const int last_index = first_index + PATCH_SIZE;
+// Patch indices starting at 0, converted by the compiler.
+static constexpr array<unsigned int, TEAPOT_PATCH_COUNT * PATCH_SIZE> makePatchIndices()
+{
+    array<unsigned int, TEAPOT_PATCH_COUNT * PATCH_SIZE> indices{};
+    for (size_t patch = 0; patch < TEAPOT_PATCH_COUNT; ++patch) {
+        for (size_t i = 0; i < PATCH_SIZE; ++i)
+            indices[patch * PATCH_SIZE + i] = TEAPOT_DATASET_PATCHES[patch][i] - 1;
+    }
+    return indices;
+}
 
-            // Get the control point from each index of this patch.
-            for (int i = first_index; i < last_index; ++i) {
-                auto index = part_indices[i];
-                control_points.emplace_back(teapot_vertices[index]);
-            }
+static constexpr auto TEAPOT_PATCH_INDICES = makePatchIndices();
 
-            // Create the sampled bezier surface and append it to the mesh.
-            const Mesh bezier_mesh = createBezierPatch(control_points,
-                                                       PATCH_ROWS,
-                                                       PATCH_COLS,
-                                                       sample_density);
-            mesh.extend(bezier_mesh);
+// Control points of each patch, gathered by the compiler.
+using PatchControlPoints = array<array<float, 3>, PATCH_SIZE>;
 
-            // Clear control points for the next patch.
-            control_points.clear();
-        }
+static constexpr array<PatchControlPoints, TEAPOT_PATCH_COUNT> gatherPatchControlPoints()
+{
+    array<PatchControlPoints, TEAPOT_PATCH_COUNT> patches{};
+    for (size_t patch = 0; patch < TEAPOT_PATCH_COUNT; ++patch) {
+        for (size_t i = 0; i < PATCH_SIZE; ++i)
+            patches[patch][i] = TEAPOT_DATASET_POINTS[TEAPOT_PATCH_INDICES[patch * PATCH_SIZE + i]];
     }
+    return patches;
+}
 
-    return mesh;
+static constexpr auto TEAPOT_PATCH_CONTROL_POINTS = gatherPatchControlPoints();
+
+static vec3 toVec3(const array<float, 3>& point)
+{
+    return vec3(point[0], point[1], point[2]);
 }
 
-static vector<vec3> teapotVertices()
+// Patches share their edges, and the lid and bottom patches collapse to poles. Patch texture
+// coordinates are local, so the welded mesh keeps them as texture seams.
+static void weldPatches(Mesh& mesh)
 {
-    return {
-        {1.4, 0.0, 2.4},
-        {1.4, -0.784, 2.4},
-        {0.784, -1.4, 2.4},
-        {0.0, -1.4, 2.4},
-        {1.3376, 0.0, 2.63125},
-        {1.3376, -0.749, 2.53125},
-        {0.749, -1.3375, 2.53125},
-        {0.0, -1.3375, 2.53125},
-        {1.4375, 0.0, 2.53125},
-        {1.4375, -0.805, 2.53125},
-        {0.805, -1.4375, 2.53125},
-        {0.0, -1.4375, 2.53125},
-        {1.5, 0.0, 2.4},
-        {1.5, -0.84, 2.4},
-        {0.84, -1.5, 2.4},
-        {0.0, -1.5, 2.4},
-        {-0.784, -1.4, 2.4},
-        {-1.4, -0.784, 2.4},
-        {-1.4, 0.0, 2.4},
-        {-0.749, -1.3375, 2.53125},
-        {-1.3376, -0.749, 2.53125},
-        {-1.3375, 0.0, 2.53125},
-        {-0.805, -1.4375, 2.53125},
-        {-1.4375, -0.805, 2.53125},
-        {-1.4375, 0.0, 2.53125},
-        {-0.84, -1.5, 2.4},
-        {-1.5, -0.84, 2.4},
-        {-1.5, 0.0, 2.4},
-        {-1.4, 0.784, 2.4},
-        {-0.784, 1.4, 2.4},
-        {0.0, 1.4, 2.4},
-        {-1.3375, 0.749, 2.53125},
-        {-0.749, 1.3375, 2.53125},
-        {0.0, 1.3375, 2.53125},
-        {-1.4375, 0.805, 2.53125},
-        {-0.805, 1.4375, 2.53125},
-        {0.0, 1.4375, 2.53125},
-        {-1.5, 0.84, 2.4},
-        {-0.84, 1.5, 2.4},
-        {0.0, 1.5, 2.4},
-        {0.784, 1.4, 2.4},
-        {1.4, 0.784, 2.4},
-        {0.749, 1.3375, 2.53125},
-        {1.3375, 0.749, 2.53126},
-        {0.805, 1.4375, 2.53126},
-        {1.4375, 0.805, 2.53125},
-        {0.84, 1.5, 2.4},
-        {1.5, 0.84, 2.4},
-        {1.76, 0.0, 1.875},
-        {1.75, -0.98, 1.875},
-        {0.98, -1.75, 1.875},
-        {0.0, -1.75, 1.875},
-        {2.0, 0.0, 1.35},
-        {2.0, -1.12, 1.35},
-        {1.12, -2.0, 1.35},
-        {0.0, -2.0, 1.35},
-        {2.0, 0.0, 0.9},
-        {2.0, -1.12, 0.9},
-        {1.12, -2.0, 0.9},
-        {0.0, -2.0, 0.9},
-        {-0.98, -1.75, 1.875},
-        {-1.75, -0.98, 1.875},
-        {-1.75, 0.0, 1.875},
-        {-1.12, -2.0, 1.35},
-        {-2.0, -1.12, 1.35},
-        {-2.0, 0.0, 1.35},
-        {-1.12, -2.0, 0.9},
-        {-2.0, -1.12, 0.9},
-        {-2.0, 0.0, 0.9},
-        {-1.75, 0.98, 1.875},
-        {-0.98, 1.75, 1.875},
-        {0.0, 1.75, 1.875},
-        {-2.0, 1.12, 1.35},
-        {-1.12, 2.0, 1.35},
-        {0.0, 2.0, 1.35},
-        {-2.0, 1.12, 0.9},
-        {-1.12, 2.0, 0.9},
-        {0.0, 2.0, 0.9},
-        {0.98, 1.75, 1.875},
-        {1.75, 0.98, 1.875},
-        {1.12, 2.0, 1.35},
-        {2.0, 1.12, 1.35},
-        {1.12, 2.0, 0.9},
-        {2.0, 1.12, 0.9},
-        {2.0, 0.0, 0.45},
-        {2.0, -1.12, 0.45},
-        {1.12, -2.0, 0.45},
-        {0.0, -2.0, 0.45},
-        {1.5, 0.0, 0.225},
-        {1.5, -0.84, 0.225},
-        {0.84, -1.5, 0.225},
-        {0.0, -1.5, 0.225},
-        {1.5, 0.0, 0.15},
-        {1.5, -0.84, 0.15},
-        {0.84, -1.6, 0.15},
-        {0.0, -1.5, 0.15},
-        {-1.12, -2.0, 0.45},
-        {-2.0, -1.12, 0.45},
-        {-2.0, 0.0, 0.45},
-        {-0.84, -1.5, 0.225},
-        {-1.5, -0.84, 0.225},
-        {-1.5, 0.0, 0.225},
-        {-0.84, -1.5, 0.15},
-        {-1.5, -0.84, 0.15},
-        {-1.5, 0.0, 0.15},
-        {-2.0, 1.12, 0.45},
-        {-1.12, 2.0, 0.45},
-        {0.0, 2.0, 0.45},
-        {-1.5, 0.84, 0.225},
-        {-0.84, 1.5, 0.225},
-        {0.0, 1.5, 0.225},
-        {-1.5, 0.84, 0.15},
-        {-0.84, 1.5, 0.15},
-        {0.0, 1.5, 0.15},
-        {1.12, 2.0, 0.45},
-        {2.0, 1.12, 0.45},
-        {0.84, 1.5, 0.225},
-        {1.5, 0.84, 0.225},
-        {0.84, 1.5, 0.15},
-        {1.5, 0.84, 0.15},
-        {-1.6, 0.0, 2.025},
-        {-1.6, -0.3, 2.025},
-        {-1.5, -0.3, 2.25},
-        {-1.5, 0.0, 2.25},
-        {-2.3, 0.0, 2.025},
-        {-2.3, -0.3, 2.025},
-        {-2.5, -0.3, 2.25},
-        {-2.5, 0.0, 2.25},
-        {-2.7, 0.0, 2.025},
-        {-2.7, -0.3, 2.025},
-        {-3.0, -0.3, 2.25},
-        {-3.0, 0.0, 2.25},
-        {-2.7, 0.0, 1.8},
-        {-2.7, -0.3, 1.8},
-        {-3.0, -0.3, 1.8},
-        {-3.0, 0.0, 1.8},
-        {-1.5, 0.3, 2.25},
-        {-1.6, 0.3, 2.025},
-        {-2.5, 0.3, 2.25},
-        {-2.3, 0.3, 2.025},
-        {-3.0, 0.3, 2.25},
-        {-2.7, 0.3, 2.025},
-        {-3.0, 0.3, 1.8},
-        {-2.7, 0.3, 1.8},
-        {-2.7, 0.0, 1.575},
-        {-2.7, -0.3, 1.575},
-        {-3.0, -0.3, 1.35},
-        {-3.0, 0.0, 1.35},
-        {-2.5, 0.0, 1.125},
-        {-2.5, -0.3, 1.125},
-        {-2.65, -0.3, 0.9375},
-        {-2.65, 0.0, 0.9375},
-        {-2.0, -0.3, 0.9},
-        {-1.9, -0.3, 0.6},
-        {-1.9, 0.0, 0.6},
-        {-3.0, 0.3, 1.35},
-        {-2.7, 0.3, 1.575},
-        {-2.65, 0.3, 0.9375},
-        {-2.5, 0.3, 1.125},
-        {-1.9, 0.3, 0.6},
-        {-2.0, 0.3, 0.9},
-        {1.7, 0.0, 1.425},
-        {1.7, -0.66, 1.425},
-        {1.7, -0.66, 0.6},
-        {1.7, 0.0, 0.6},
-        {2.6, 0.0, 1.425},
-        {2.6, -0.66, 1.425},
-        {3.1, -0.66, 0.825},
-        {3.1, 0.0, 0.825},
-        {2.3, 0.0, 2.1},
-        {2.3, -0.25, 2.1},
-        {2.4, -0.25, 2.025},
-        {2.4, 0.0, 2.025},
-        {2.7, 0.0, 2.4},
-        {2.7, -0.25, 2.4},
-        {3.3, -0.25, 2.4},
-        {3.3, 0.0, 2.4},
-        {1.7, 0.66, 0.6},
-        {1.7, 0.66, 1.425},
-        {3.1, 0.66, 0.825},
-        {2.6, 0.66, 1.425},
-        {2.4, 0.25, 2.025},
-        {2.3, 0.25, 2.1},
-        {3.3, 0.25, 2.4},
-        {2.7, 0.25, 2.4},
-        {2.8, 0.0, 2.475},
-        {2.8, -0.25, 2.475},
-        {3.525, -0.25, 2.49375},
-        {3.525, 0.0, 2.49375},
-        {2.9, 0.0, 2.475},
-        {2.9, -0.15, 2.475},
-        {3.45, -0.15, 2.5125},
-        {3.45, 0.0, 2.5125},
-        {2.8, 0.0, 2.4},
-        {2.8, -0.15, 2.4},
-        {3.2, -0.15, 2.4},
-        {3.2, 0.0, 2.4},
-        {3.525, 0.25, 2.49375},
-        {2.8, 0.25, 2.475},
-        {3.45, 0.15, 2.5125},
-        {2.9, 0.15, 2.475},
-        {3.2, 0.15, 2.4},
-        {2.8, 0.15, 2.4},
-        {0.0, 0.0, 3.15},
-        {0.0, -0.002, 3.15},
-        {0.002, 0.0, 3.15},
-        {0.8, 0.0, 3.15},
-        {0.8, -0.45, 3.15},
-        {0.45, -0.8, 3.15},
-        {0.0, -0.8, 3.15},
-        {0.0, 0.0, 2.85},
-        {0.2, 0.0, 2.7},
-        {0.2, -0.112, 2.7},
-        {0.112, -0.2, 2.7},
-        {0.0, -0.2, 2.7},
-        {-0.002, 0.0, 3.15},
-        {-0.45, -0.8, 3.15},
-        {-0.8, -0.45, 3.15},
-        {-0.8, 0.0, 3.15},
-        {-0.112, -0.2, 2.7},
-        {-0.2, -0.112, 2.7},
-        {-0.2, 0.0, 2.7},
-        {0.0, 0.002, 3.15},
-        {-0.8, 0.45, 3.15},
-        {-0.45, 0.8, 3.15},
-        {0.0, 0.8, 3.15},
-        {-0.2, 0.112, 2.7},
-        {-0.112, 0.2, 2.7},
-        {0.0, 0.2, 2.7},
-        {0.45, 0.8, 3.15},
-        {0.8, 0.45, 3.15},
-        {0.112, 0.2, 2.7},
-        {0.2, 0.112, 2.7},
-        {0.4, 0.0, 2.55},
-        {0.4, -0.224, 2.55},
-        {0.224, -0.4, 2.55},
-        {0.0, -0.4, 2.55},
-        {1.3, 0.0, 2.55},
-        {1.3, -0.728, 2.55},
-        {0.728, -1.3, 2.55},
-        {0.0, -1.3, 2.55},
-        {1.3, 0.0, 2.4},
-        {1.3, -0.728, 2.4},
-        {0.728, -1.3, 2.4},
-        {0.0, -1.3, 2.4},
-        {-0.224, -0.4, 2.55},
-        {-0.4, -0.224, 2.55},
-        {-0.4, 0.0, 2.55},
-        {-0.728, -1.3, 2.55},
-        {-1.3, -0.728, 2.55},
-        {-1.3, 0.0, 2.55},
-        {-0.728, -1.3, 2.4},
-        {-1.3, -0.728, 2.4},
-        {-1.3, 0.0, 2.4},
-        {-0.4, 0.224, 2.55},
-        {-0.224, 0.4, 2.55},
-        {0.0, 0.4, 2.55},
-        {-1.3, 0.728, 2.55},
-        {-0.728, 1.3, 2.55},
-        {0.0, 1.3, 2.55},
-        {-1.3, 0.728, 2.4},
-        {-0.728, 1.3, 2.4},
-        {0.0, 1.3, 2.4},
-        {0.224, 0.4, 2.55},
-        {0.4, 0.224, 2.55},
-        {0.728, 1.3, 2.55},
-        {1.3, 0.728, 2.55},
-        {0.728, 1.3, 2.4},
-        {1.3, 0.728, 2.4},
-        {0.0, 0.0, 0.0},
-        {1.5, 0.0, 0.15},
-        {1.5, 0.84, 0.15},
-        {0.84, 1.5, 0.15},
-        {0.0, 1.5, 0.15},
-        {1.5, 0.0, 0.075},
-        {1.5, 0.84, 0.075},
-        {0.84, 1.5, 0.075},
-        {0.0, 1.5, 0.075},
-        {1.425, 0.0, 0.0},
-        {1.425, 0.798, 0.0},
-        {0.798, 1.425, 0.0},
-        {0.0, 1.425, 0.0},
-        {-0.84, 1.5, 0.15},
-        {-1.5, 0.84, 0.15},
-        {-1.5, 0.0, 0.15},
-        {-0.84, 1.5, 0.075},
-        {-1.5, 0.84, 0.075},
-        {-1.5, 0.0, 0.075},
-        {-0.798, 1.425, 0.0},
-        {-1.425, 0.798, 0.0},
-        {-1.425, 0.0, 0.0},
-        {-1.5, -0.84, 0.15},
-        {-0.84, -1.5, 0.15},
-        {0.0, -1.5, 0.15},
-        {-1.5, -0.84, 0.075},
-        {-0.84, -1.5, 0.075},
-        {0.0, -1.5, 0.075},
-        {-1.425, -0.798, 0.0},
-        {-0.798, -1.425, 0.0},
-        {0.0, -1.425, 0.0},
-        {0.84, -1.5, 0.15},
-        {1.5, -0.84, 0.15},
-        {0.84, -1.5, 0.075},
-        {1.5, -0.84, 0.075},
-        {0.798, -1.425, 0.0},
-        {1.425, -0.798, 0.0}
-    };
+    WeldOptions weld_options;
+    weld_options.mode = WeldMode::POSITION;
+    weldVertices(mesh, weld_options);
 }
 
-// The original dataset has indices starting at 1.
-// This function returns the correct patches with indices starting at 0.
-static vector<unsigned int> teapotPatch(TeapotParts part)
+// Sample all patches on the same grid, each in its own slice of the mapped buffers of `mesh`.
+// Returns false if the buffers could not be mapped.
+static bool streamTeapot(const BernsteinTable& row_table, const BernsteinTable& col_table, Mesh& mesh)
 {
-    vector<unsigned int> patch_indices;
+    const int rows = row_table.n_samples;
+    const int cols = col_table.n_samples;
+    const size_t patch_vertices = static_cast<size_t>(rows) * cols;
+    const size_t patch_indices = patchIndexCount(rows, cols);
 
-    if (part == TeapotParts::RIM) {
-        patch_indices = {
-            1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16,
-            4, 17, 18, 19, 8, 20, 21, 22, 12, 23, 24, 25, 16, 26, 27, 28,
-            19, 29, 30, 31, 22, 32, 33, 34, 25, 35, 36, 37, 28, 38, 39, 40,
-            31, 41, 42, 1, 34, 43, 44, 5, 37, 45, 46, 9, 40, 47, 48, 13
-        };
-    }
-    else if (part == TeapotParts::BODY) {
-        patch_indices = {
-            13, 14, 15, 16, 49, 50, 51, 52, 53, 54, 55, 56, 57, 58, 59, 60,
-            16, 26, 27, 28, 52, 61, 62, 63, 56, 64, 65, 66, 60, 67, 68, 69,
-            28, 38, 39, 40, 63, 70, 71, 72, 66, 73, 74, 75, 69, 76, 77, 78,
-            40, 47, 48, 13, 72, 79, 80, 49, 75, 81, 82, 53, 78, 83, 84, 57,
-            57, 58, 59, 60, 85, 86, 87, 88, 89, 90, 91, 92, 93, 94, 95, 96,
-            60, 67, 68, 69, 88, 97, 98, 99, 92, 100, 101, 102, 96, 103, 104, 105,
-            69, 76, 77, 78, 99, 106, 107, 108, 102, 109, 110, 111, 105, 112, 113, 114,
-            78, 83, 84, 57, 108, 115, 116, 85, 111, 117, 118, 89, 114, 119, 120, 93
-        };
-    }
-    else if (part == TeapotParts::HANDLE) {
-        patch_indices = {
-            121, 122, 123, 124, 125, 126, 127, 128, 129, 130, 131, 132, 133, 134, 135, 136,
-            124, 137, 138, 121, 128, 139, 140, 125, 132, 141, 142, 129, 136, 143, 144, 133,
-            133, 134, 135, 136, 145, 146, 147, 148, 149, 150, 151, 152, 69, 153, 154, 155,
-            136, 143, 144, 133, 148, 156, 157, 145, 152, 158, 159, 149, 155, 160, 161, 69
-        };
-    }
-    else if (part == TeapotParts::SPOUT) {
-        patch_indices = {
-            162, 163, 164, 165, 166, 167, 168, 169, 170, 171, 172, 173, 174, 175, 176, 177,
-            165, 178, 179, 162, 169, 180, 181, 166, 173, 182, 183, 170, 177, 184, 185, 174,
-            174, 175, 176, 177, 186, 187, 188, 189, 190, 191, 192, 193, 194, 195, 196, 197,
-            177, 184, 185, 174, 189, 198, 199, 186, 193, 200, 201, 190, 197, 202, 203, 194
-        };
-    }
-    else if (part == TeapotParts::LID) {
-        patch_indices = {
-            204, 204, 204, 204, 207, 208, 209, 210, 211, 211, 211, 211, 212, 213, 214, 215,
-            204, 204, 204, 204, 210, 217, 218, 219, 211, 211, 211, 211, 215, 220, 221, 222,
-            204, 204, 204, 204, 219, 224, 225, 226, 211, 211, 211, 211, 222, 227, 228, 229,
-            204, 204, 204, 204, 226, 230, 231, 207, 211, 211, 211, 211, 229, 232, 233, 212,
-            212, 213, 214, 215, 234, 235, 236, 237, 238, 239, 240, 241, 242, 243, 244, 245,
-            215, 220, 221, 222, 237, 246, 247, 248, 241, 249, 250, 251, 245, 252, 253, 254,
-            222, 227, 228, 229, 248, 255, 256, 257, 251, 258, 259, 260, 254, 261, 262, 263,
-            229, 232, 233, 212, 257, 264, 265, 234, 260, 266, 267, 238, 263, 268, 269, 242
-        };
-    }
-    else {
-        // part == TeapotParts::BOTTOM.
-        patch_indices = {
-            270, 270, 270, 270, 279, 280, 281, 282, 275, 276, 277, 278, 271, 272, 273, 274,
-            270, 270, 270, 270, 282, 289, 290, 291, 278, 286, 287, 288, 274, 283, 284, 285,
-            270, 270, 270, 270, 291, 298, 299, 300, 288, 295, 296, 297, 285, 292, 293, 294,
-            270, 270, 270, 270, 300, 305, 306, 279, 297, 303, 304, 275, 294, 301, 302, 271
-        };
+    MappedMeshBuffers buffers;
+    do {
+        buffers = mesh.mapGpuBuffers(TEAPOT_PATCH_COUNT * patch_vertices, TEAPOT_PATCH_COUNT * patch_indices);
+        if (buffers.vertices == nullptr)
+            return false;
+        parallelFor(0, TEAPOT_PATCH_COUNT, 1, [&](size_t patch_begin, size_t patch_end) {
+            vector<vec3> control_points(PATCH_SIZE);
+            for (size_t patch = patch_begin; patch < patch_end; ++patch) {
+                for (int i = 0; i < PATCH_SIZE; ++i)
+                    control_points[i] = toVec3(TEAPOT_PATCH_CONTROL_POINTS[patch][i]);
+
+                const auto first_vertex = static_cast<unsigned int>(patch * patch_vertices);
+                sampleBezierPatch(control_points, row_table, col_table, 0, rows,
+                                  buffers.vertices + first_vertex);
+                if (buffers.short_indices)
+                    writePatchIndices(static_cast<uint16_t*>(buffers.indices) + patch * patch_indices,
+                                      rows, cols, first_vertex);
+                else
+                    writePatchIndices(static_cast<unsigned int*>(buffers.indices) + patch * patch_indices,
+                                      rows, cols, first_vertex);
+            }
+        });
+    } while (!mesh.unmapGpuBuffers());
+    return true;
+}
+
+Mesh createTeapot(float sample_density, MeshStorage storage)
+{
+    // Every patch is sampled on the same grid, so the basis is tabulated once.
+    const BernsteinTable row_table(PATCH_ROWS - 1, static_cast<int>(PATCH_ROWS * sample_density));
+    const BernsteinTable col_table(PATCH_COLS - 1, static_cast<int>(PATCH_COLS * sample_density));
+
+    // If the buffers cannot be mapped, the teapot is built in CPU memory as for the other storages.
+    Mesh mesh;
+    if (storage == MeshStorage::GPU && streamTeapot(row_table, col_table, mesh))
+        return mesh;
+
+    // Reuse the control points buffer for each patch.
+    vector<vec3> control_points(PATCH_SIZE);
+
+    // Sample each patch, triangulate it and append it to the mesh.
+    for (const auto& patch : TEAPOT_PATCH_CONTROL_POINTS) {
+        for (int i = 0; i < PATCH_SIZE; ++i)
+            control_points[i] = toVec3(patch[i]);
+
+        const Mesh bezier_mesh = createBezierPatch(control_points, row_table, col_table);
+        mesh.extend(bezier_mesh);
     }
 
-    // Subtract 1 to start indices at 0.
-    for (auto& index : patch_indices)
-        index--;
+    weldPatches(mesh);
+    if (storage != MeshStorage::CPU)
+        mesh.pushToGpu();
+    if (storage == MeshStorage::GPU)
+        mesh.releaseCpu();
+    return mesh;
+}
+
+Mesh createAdaptiveTeapot(float max_error)
+{
+    vector<vec3> control_points;
+    control_points.reserve(TEAPOT_CONTROL_POINT_COUNT);
+    for (const auto& point : TEAPOT_DATASET_POINTS)
+        control_points.push_back(toVec3(point));
+
+    // All parts at once, so sample counts also match where parts meet.
+    const vector<unsigned int> patch_indices(TEAPOT_PATCH_INDICES.begin(), TEAPOT_PATCH_INDICES.end());
+    Mesh mesh = createAdaptiveBezierPatches(control_points, patch_indices,
+                                            PATCH_ROWS, PATCH_COLS, max_error);
+    weldPatches(mesh);
+    return mesh;
+}
 
-    return patch_indices;
+const array<array<float, 3>, TEAPOT_CONTROL_POINT_COUNT>& teapotControlPoints()
+{
+    return TEAPOT_DATASET_POINTS;
+}
+
+const array<unsigned int, TEAPOT_PATCH_COUNT * 16>& teapotPatchIndices()
+{
+    return TEAPOT_PATCH_INDICES;
 }
@@ -1,8 +1,26 @@
 #ifndef TEAPOT_HPP
 #define TEAPOT_HPP
 
+#include <array>
+
 #include "Mesh.hpp"
 
-Mesh createTeapot(float sample_density = 1.0f);
+// Teapot with every patch sampled on the same grid. With MeshStorage::GPU, the patches are
+// sampled in parallel straight into the mapped buffers and are not welded together, unless the
+// buffers cannot be mapped and the teapot is built in CPU memory instead.
+Mesh createTeapot(float sample_density = 1.0f, MeshStorage storage = MeshStorage::CPU);
+
+// Teapot whose patches are each sampled just enough to stay within `max_error` of the surface,
+// in teapot units, without cracks between patches sampled differently.
+Mesh createAdaptiveTeapot(float max_error);
+
+// The teapot dataset: 32 bicubic patches sharing 306 control points.
+constexpr int TEAPOT_CONTROL_POINT_COUNT = 306;
+constexpr int TEAPOT_PATCH_COUNT = 32;
+
+// Control points of the teapot, and the 16 control point indices of each of its bicubic patches,
+// row by row. Both are static tables, built at compile time and ready to be uploaded.
+const std::array<std::array<float, 3>, TEAPOT_CONTROL_POINT_COUNT>& teapotControlPoints();
+const std::array<unsigned int, TEAPOT_PATCH_COUNT * 16>& teapotPatchIndices();
 
 #endif // TEAPOT_HPP
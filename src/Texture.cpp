@@ -7,6 +7,8 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
+#include "GlState.hpp"
+
 using namespace std;
 
 Texture::Texture(const std::string& filename):
@@ -45,7 +47,7 @@ Texture::Texture(const std::string& filename):
 
     // Create texture.
     glGenTextures(1, &id_);
-    glBindTexture(GL_TEXTURE_2D, id_);
+    bind();
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width_, height_, 0, format, GL_UNSIGNED_BYTE, buffer_);
 
     // Set texture parameters. These parameters MUST BE SET, or else we get a black texture.
@@ -68,11 +70,15 @@ Texture::Texture(const std::string& filename):
 
 void Texture::bind(int slot) const
 {
-    glActiveTexture(GL_TEXTURE0 + slot);
-    glBindTexture(GL_TEXTURE_2D, id_);
+    GlState::bindTexture(slot, id_);
+}
+
+void Texture::unbind(int slot) const
+{
+    GlState::bindTexture(slot, 0);
 }
 
-void Texture::unbind() const
+unsigned int Texture::getId() const
 {
-    glBindTexture(GL_TEXTURE_2D, 0);
+    return id_;
 }
@@ -18,8 +18,11 @@ public:
 
     // Bind texture to a specific slot.
     void bind(int slot = 0) const;
-    // Unbind texture.
-    void unbind() const;
+    // Unbind texture from a specific slot.
+    void unbind(int slot = 0) const;
+
+    // OpenGL handle.
+    unsigned int getId() const;
 };
 
 #endif // TEXTURE_HPP
@@ -0,0 +1,266 @@
+#include "TransformHierarchy.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+#include "Math.hpp"
+#include "Parallel.hpp"
+
+using namespace std;
+using glm::vec3;
+using glm::mat3;
+using glm::mat4;
+
+// Below this amount of nodes in a level, spawning threads costs more than it saves.
+static constexpr size_t MIN_NODES_PER_TASK = 4096;
+
+// Move every element at slot i to slot new_slot[i].
+template <typename T>
+static void permute(vector<T>& values, const vector<uint32_t>& new_slot)
+{
+    vector<T> permuted(values.size());
+    for (size_t i = 0; i < values.size(); ++i)
+        permuted[new_slot[i]] = values[i];
+    values.swap(permuted);
+}
+
+
+TransformHierarchy::TransformHierarchy():
+    level_begin_{0},
+    is_sorted_(true),
+    is_dirty_(false)
+{
+}
+
+TransformHierarchy::NodeId TransformHierarchy::addNode(NodeId parent)
+{
+    const auto id = static_cast<NodeId>(slot_of_id_.size());
+    const auto slot = static_cast<uint32_t>(parent_.size());
+
+    uint32_t parent_slot = NO_NODE;
+    uint32_t level = 0;
+    if (parent != NO_NODE) {
+        assert(parent < slot_of_id_.size());
+        parent_slot = slot_of_id_[parent];
+        level = level_[parent_slot] + 1;
+    }
+
+    // Appending keeps the slots sorted as long as levels never decrease.
+    const size_t n_levels = level_begin_.size() - 1;
+    if (is_sorted_ && level + 1 >= n_levels) {
+        if (level == n_levels)
+            level_begin_.push_back(slot + 1);
+        else
+            level_begin_.back() = slot + 1;
+    }
+    else {
+        is_sorted_ = false;
+    }
+
+    slot_of_id_.push_back(slot);
+    id_of_slot_.push_back(id);
+    parent_.push_back(parent_slot);
+    level_.push_back(level);
+    pos_.emplace_back(0.0f);
+    ori_x_.emplace_back(1.0f, 0.0f, 0.0f);
+    ori_y_.emplace_back(0.0f, 1.0f, 0.0f);
+    ori_z_.emplace_back(0.0f, 0.0f, 1.0f);
+    scale_.emplace_back(1.0f);
+    local_.emplace_back(1.0f);
+    world_.emplace_back(1.0f);
+    local_normal_.emplace_back(1.0f);
+    world_normal_.emplace_back(1.0f);
+    is_local_dirty_.push_back(1);
+    is_world_changed_.push_back(0);
+
+    is_dirty_ = true;
+    return id;
+}
+
+size_t TransformHierarchy::size() const
+{
+    return parent_.size();
+}
+
+const vec3& TransformHierarchy::position(NodeId node) const
+{
+    return pos_[slot_of_id_[node]];
+}
+
+const vec3& TransformHierarchy::orientationX(NodeId node) const
+{
+    return ori_x_[slot_of_id_[node]];
+}
+
+const vec3& TransformHierarchy::orientationY(NodeId node) const
+{
+    return ori_y_[slot_of_id_[node]];
+}
+
+const vec3& TransformHierarchy::orientationZ(NodeId node) const
+{
+    return ori_z_[slot_of_id_[node]];
+}
+
+const vec3& TransformHierarchy::scale(NodeId node) const
+{
+    return scale_[slot_of_id_[node]];
+}
+
+void TransformHierarchy::setPosition(NodeId node, const vec3& pos)
+{
+    const uint32_t slot = slot_of_id_[node];
+    if (pos_[slot] == pos)
+        return;
+
+    pos_[slot] = pos;
+    is_local_dirty_[slot] = 1;
+    is_dirty_ = true;
+}
+
+void TransformHierarchy::setOrientation(NodeId node,
+                                        const vec3& ori_x,
+                                        const vec3& ori_y,
+                                        const vec3& ori_z)
+{
+    const uint32_t slot = slot_of_id_[node];
+    if (ori_x_[slot] == ori_x && ori_y_[slot] == ori_y && ori_z_[slot] == ori_z)
+        return;
+
+    ori_x_[slot] = ori_x;
+    ori_y_[slot] = ori_y;
+    ori_z_[slot] = ori_z;
+    is_local_dirty_[slot] = 1;
+    is_dirty_ = true;
+}
+
+void TransformHierarchy::setScale(NodeId node, const vec3& scale)
+{
+    const uint32_t slot = slot_of_id_[node];
+    if (scale_[slot] == scale)
+        return;
+
+    scale_[slot] = scale;
+    is_local_dirty_[slot] = 1;
+    is_dirty_ = true;
+}
+
+const mat4& TransformHierarchy::localTransformation(NodeId node)
+{
+    updateWorldTransforms();
+    return local_[slot_of_id_[node]];
+}
+
+const mat4& TransformHierarchy::worldTransformation(NodeId node)
+{
+    updateWorldTransforms();
+    return world_[slot_of_id_[node]];
+}
+
+const mat3& TransformHierarchy::worldNormalMatrix(NodeId node)
+{
+    updateWorldTransforms();
+    return world_normal_[slot_of_id_[node]];
+}
+
+void TransformHierarchy::updateWorldTransforms()
+{
+    if (!is_dirty_)
+        return;
+
+    if (!is_sorted_)
+        sortByLevel();
+
+    // Levels are processed in order, so parents are always up to date before their children.
+    for (size_t level = 0; level + 1 < level_begin_.size(); ++level) {
+        parallelFor(level_begin_[level], level_begin_[level + 1], MIN_NODES_PER_TASK,
+                    [this](size_t begin, size_t end) { updateRange(begin, end); });
+    }
+
+    fill(is_local_dirty_.begin(), is_local_dirty_.end(), 0);
+    fill(is_world_changed_.begin(), is_world_changed_.end(), 0);
+    is_dirty_ = false;
+}
+
+void TransformHierarchy::updateRange(size_t begin, size_t end)
+{
+    // Rebuild outdated local transformations, one batch per run of consecutive dirty slots.
+    size_t run_begin = begin;
+    while (run_begin < end) {
+        if (!is_local_dirty_[run_begin]) {
+            ++run_begin;
+            continue;
+        }
+        size_t run_end = run_begin + 1;
+        while (run_end < end && is_local_dirty_[run_end])
+            ++run_end;
+
+        composeTransforms(&pos_[run_begin], &ori_x_[run_begin], &ori_y_[run_begin],
+                          &ori_z_[run_begin], &scale_[run_begin],
+                          run_end - run_begin,
+                          &local_[run_begin], &local_normal_[run_begin]);
+        run_begin = run_end;
+    }
+
+    // The inverse transpose of a product is the product of the inverse transposes, so normal
+    // matrices are chained just like the transformations themselves.
+    for (size_t slot = begin; slot < end; ++slot) {
+        const uint32_t parent = parent_[slot];
+        const bool is_parent_changed = parent != NO_NODE && is_world_changed_[parent];
+
+        if (is_local_dirty_[slot] || is_parent_changed) {
+            if (parent == NO_NODE) {
+                world_[slot] = local_[slot];
+                world_normal_[slot] = local_normal_[slot];
+            }
+            else {
+                world_[slot] = world_[parent] * local_[slot];
+                world_normal_[slot] = world_normal_[parent] * local_normal_[slot];
+            }
+            is_world_changed_[slot] = 1;
+        }
+    }
+}
+
+void TransformHierarchy::sortByLevel()
+{
+    const size_t n_nodes = size();
+    const uint32_t n_levels = *max_element(level_.begin(), level_.end()) + 1;
+
+    // Counting sort by level. It is stable, so order within a level is preserved.
+    level_begin_.assign(n_levels + 1, 0);
+    for (const auto level : level_)
+        level_begin_[level + 1]++;
+    for (uint32_t level = 0; level < n_levels; ++level)
+        level_begin_[level + 1] += level_begin_[level];
+
+    vector<size_t> cursor(level_begin_.begin(), level_begin_.end() - 1);
+    vector<uint32_t> new_slot(n_nodes);
+    for (size_t slot = 0; slot < n_nodes; ++slot)
+        new_slot[slot] = static_cast<uint32_t>(cursor[level_[slot]]++);
+
+    // Parent links refer to slots, so they must be remapped before being moved.
+    for (auto& parent : parent_) {
+        if (parent != NO_NODE)
+            parent = new_slot[parent];
+    }
+
+    permute(parent_, new_slot);
+    permute(level_, new_slot);
+    permute(pos_, new_slot);
+    permute(ori_x_, new_slot);
+    permute(ori_y_, new_slot);
+    permute(ori_z_, new_slot);
+    permute(scale_, new_slot);
+    permute(local_, new_slot);
+    permute(world_, new_slot);
+    permute(local_normal_, new_slot);
+    permute(world_normal_, new_slot);
+    permute(is_local_dirty_, new_slot);
+    permute(is_world_changed_, new_slot);
+    permute(id_of_slot_, new_slot);
+    for (auto& slot : slot_of_id_)
+        slot = new_slot[slot];
+
+    is_sorted_ = true;
+}
@@ -0,0 +1,94 @@
+#ifndef TRANSFORM_HIERARCHY_HPP
+#define TRANSFORM_HIERARCHY_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/vec3.hpp>
+#include <glm/mat3x3.hpp>
+#include <glm/mat4x4.hpp>
+
+// Flat storage for the transformations of a node hierarchy.
+//
+// Node data lives in contiguous arrays (structure of arrays), indexed by a slot. Slots are kept
+// sorted by hierarchy level, so every parent is stored before its children and the nodes of one
+// level form a contiguous range. World transformations are then updated in a single linear pass,
+// level by level, and each level is split in chunks processed in parallel.
+//
+// Nodes are referred to by a stable NodeId, since slots move around when the arrays are re-sorted.
+// References returned by the getters are invalidated when nodes are added.
+class TransformHierarchy
+{
+public:
+
+    using NodeId = uint32_t;
+    static constexpr NodeId NO_NODE = UINT32_MAX;
+
+    TransformHierarchy();
+
+    // Add a node with an identity transformation. Use NO_NODE as parent to add a root node.
+    NodeId addNode(NodeId parent = NO_NODE);
+
+    // Number of nodes.
+    size_t size() const;
+
+    // Transform getters.
+    const glm::vec3& position(NodeId node) const;
+    const glm::vec3& orientationX(NodeId node) const;
+    const glm::vec3& orientationY(NodeId node) const;
+    const glm::vec3& orientationZ(NodeId node) const;
+    const glm::vec3& scale(NodeId node) const;
+
+    // Transform setters. Writing an unchanged value does not invalidate anything.
+    void setPosition(NodeId node, const glm::vec3& pos);
+    void setOrientation(NodeId node,
+                        const glm::vec3& ori_x,
+                        const glm::vec3& ori_y,
+                        const glm::vec3& ori_z);
+    void setScale(NodeId node, const glm::vec3& scale);
+
+    // Get cached transformations, updating the whole hierarchy first if anything changed.
+    const glm::mat4& localTransformation(NodeId node);
+    const glm::mat4& worldTransformation(NodeId node);
+    // Inverse transpose of the upper 3x3 block of the world transformation, to transform normals.
+    const glm::mat3& worldNormalMatrix(NodeId node);
+
+    // Recompute outdated local and world transformations. Does nothing if no node changed.
+    void updateWorldTransforms();
+
+private:
+
+    // Reorder all arrays by hierarchy level.
+    void sortByLevel();
+    // Update the transformations of the slots in [begin, end). All of them must be on one level.
+    void updateRange(size_t begin, size_t end);
+
+    // Stable node id to current slot, and back.
+    std::vector<uint32_t> slot_of_id_;
+    std::vector<NodeId> id_of_slot_;
+
+    // Node data, indexed by slot.
+    std::vector<uint32_t> parent_;
+    std::vector<uint32_t> level_;
+    std::vector<glm::vec3> pos_;
+    std::vector<glm::vec3> ori_x_;
+    std::vector<glm::vec3> ori_y_;
+    std::vector<glm::vec3> ori_z_;
+    std::vector<glm::vec3> scale_;
+    std::vector<glm::mat4> local_;
+    std::vector<glm::mat4> world_;
+    std::vector<glm::mat3> local_normal_;
+    std::vector<glm::mat3> world_normal_;
+    // Whether the local transformation is outdated, and whether the world transformation changed
+    // during the current update. Bytes rather than std::vector<bool>, so threads can write them.
+    std::vector<uint8_t> is_local_dirty_;
+    std::vector<uint8_t> is_world_changed_;
+
+    // Slot range of each level: level L occupies [level_begin_[L], level_begin_[L+1]).
+    std::vector<size_t> level_begin_;
+
+    bool is_sorted_;
+    bool is_dirty_;
+};
+
+#endif // TRANSFORM_HIERARCHY_HPP
@@ -0,0 +1,39 @@
+#include "UniformBuffer.hpp"
+
+#include <cassert>
+
+#include <glad/glad.h>
+
+UniformBuffer::UniformBuffer(size_t size, unsigned int binding):
+    id_(0), size_(size), binding_(binding)
+{
+    assert(size > 0);
+
+    // Allocate the buffer storage, its content is uploaded later.
+    glGenBuffers(1, &id_);
+    glBindBuffer(GL_UNIFORM_BUFFER, id_);
+    glBufferData(GL_UNIFORM_BUFFER, size_, NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    // Attach the whole buffer to its binding point.
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding_, id_);
+}
+
+UniformBuffer::~UniformBuffer()
+{
+    glDeleteBuffers(1, &id_);
+}
+
+unsigned int UniformBuffer::binding() const
+{
+    return binding_;
+}
+
+void UniformBuffer::update(const void* data, size_t size, size_t offset) const
+{
+    assert(offset + size <= size_);
+
+    glBindBuffer(GL_UNIFORM_BUFFER, id_);
+    glBufferSubData(GL_UNIFORM_BUFFER, offset, size, data);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
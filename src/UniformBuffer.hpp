@@ -0,0 +1,30 @@
+#ifndef UNIFORM_BUFFER_HPP
+#define UNIFORM_BUFFER_HPP
+
+#include <cstddef>
+
+// Class abstraction of an OpenGL Uniform Buffer Object, attached to a fixed binding point.
+// Shader programs read it through a uniform block assigned to the same binding point, see
+// ShaderProgram::bindUniformBlock().
+class UniformBuffer
+{
+private:
+    unsigned int id_;
+    size_t size_;
+    unsigned int binding_;
+
+public:
+    UniformBuffer(size_t size, unsigned int binding);
+    ~UniformBuffer();
+
+    UniformBuffer(const UniformBuffer&) = delete;
+    UniformBuffer& operator=(const UniformBuffer&) = delete;
+
+    // Binding point used by the buffer.
+    unsigned int binding() const;
+
+    // Replace `size` bytes of the buffer content, starting at `offset`.
+    void update(const void* data, size_t size, size_t offset = 0) const;
+};
+
+#endif // UNIFORM_BUFFER_HPP
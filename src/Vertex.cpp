@@ -1,7 +1,33 @@
 #include "Vertex.hpp"
 
+#include <algorithm>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include "Math.hpp"
+
+using namespace std;
 using glm::vec2;
 using glm::vec3;
+using glm::vec4;
+using glm::mat4;
+
+static_assert(sizeof(PackedVertex) == 16, "PackedVertex must be tightly packed");
+static_assert(sizeof(PackedPosition) == 8, "PackedPosition must be tightly packed");
+
+// Quantize a position to snorm16, within the box mapped by `dequantization`.
+static void quantizePosition(const vec3& pos, const mat4& dequantization, int16_t* out)
+{
+    // The dequantization is a scale followed by a translation, so it is inverted per component.
+    const vec3 center = vec3(dequantization[3]);
+    const vec3 half_extent = vec3(dequantization[0][0], dequantization[1][1], dequantization[2][2]);
+
+    const vec3 unit_pos = (pos - center) / half_extent;
+    for (int c = 0; c < 3; ++c)
+        out[c] = static_cast<int16_t>(glm::packSnorm1x16(unit_pos[c]));
+    out[3] = 0;
+}
 
 // Vertex intialization.
 Vertex::Vertex():
@@ -23,3 +49,46 @@ Vertex::Vertex(const vec3& p_pos, const vec3& p_normal, const vec2& p_tex):
     pos(p_pos), normal(p_normal), tex(p_tex)
 {
 }
+
+mat4 computeDequantization(const vector<Vertex>& vertices)
+{
+    if (vertices.empty())
+        return mat4(1.0f);
+
+    vec3 lower = vertices[0].pos;
+    vec3 upper = vertices[0].pos;
+    for (const auto& v : vertices) {
+        lower = glm::min(lower, v.pos);
+        upper = glm::max(upper, v.pos);
+    }
+
+    const vec3 center = 0.5f * (lower + upper);
+    vec3 half_extent = 0.5f * (upper - lower);
+    // Flat meshes still need an invertible mapping.
+    for (int i = 0; i < 3; ++i)
+        half_extent[i] = half_extent[i] > 0.0f ? half_extent[i] : 1.0f;
+
+    return getTranslation(center) * getScale(half_extent);
+}
+
+vector<PackedVertex> packVertices(const vector<Vertex>& vertices, const mat4& dequantization)
+{
+    vector<PackedVertex> packed(vertices.size());
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        const Vertex& v = vertices[i];
+        PackedVertex& p = packed[i];
+
+        quantizePosition(v.pos, dequantization, p.pos);
+        p.normal = glm::packSnorm3x10_1x2(vec4(v.normal, 0.0f));
+        p.tex = glm::packHalf2x16(v.tex);
+    }
+    return packed;
+}
+
+vector<PackedPosition> packPositions(const vector<Vertex>& vertices, const mat4& dequantization)
+{
+    vector<PackedPosition> packed(vertices.size());
+    for (size_t i = 0; i < vertices.size(); ++i)
+        quantizePosition(vertices[i].pos, dequantization, packed[i].pos);
+    return packed;
+}
@@ -1,8 +1,12 @@
 #ifndef VERTEX_HPP
 #define VERTEX_HPP
 
+#include <cstdint>
+#include <vector>
+
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
+#include <glm/mat4x4.hpp>
 
 // Struct that contains every piece of data for a single vertex.
 struct Vertex
@@ -21,4 +25,42 @@ public:
     glm::vec2 tex;
 };
 
+// Layout of vertex data in GPU buffers.
+enum class VertexFormat
+{
+    // Vertex as is: 32 bytes.
+    FLOAT32,
+    // PackedVertex: 16 bytes.
+    PACKED
+};
+
+// Compact vertex, decoded by the vertex fetch hardware, so shaders read the same attributes as
+// for a Vertex:
+// - position as snorm16, relative to the mesh bounds (see computeDequantization()),
+// - normal as snorm 10-10-10-2,
+// - texture coords as half floats.
+struct PackedVertex
+{
+    int16_t pos[4];
+    uint32_t normal;
+    uint32_t tex;
+};
+
+// Position of a PackedVertex alone, for position-only streams: 8 bytes.
+struct PackedPosition
+{
+    int16_t pos[4];
+};
+
+// Transformation from snorm16 positions back to object space: it maps [-1, 1]^3 to the bounding
+// box of the vertices.
+glm::mat4 computeDequantization(const std::vector<Vertex>& vertices);
+
+// Pack vertices, quantizing positions to the box mapped by `dequantization`.
+std::vector<PackedVertex> packVertices(const std::vector<Vertex>& vertices,
+                                       const glm::mat4& dequantization);
+// Pack vertex positions only, quantized the same way.
+std::vector<PackedPosition> packPositions(const std::vector<Vertex>& vertices,
+                                          const glm::mat4& dequantization);
+
 #endif // VERTEX_HPP
@@ -2,10 +2,26 @@
 
 layout (location = 0) in vec3 in_pos;
 
+// Per frame data, shared by all programs.
+layout (std140) uniform FrameData
+{
+    mat4 u_view;
+    mat4 u_projection;
+    mat4 u_light_view;
+    mat4 u_light_projection;
+    vec3 u_light_position;
+    float u_ambient_coef;
+    float u_diffuse_coef;
+    float u_specular_coef;
+};
+
+#ifdef INSTANCED
+// Per instance model matrix, read from the instance buffer.
+layout (location = 3) in mat4 in_model;
+#else
 // Transforms and geometry data.
 uniform mat4 u_model;
-uniform mat4 u_view;
-uniform mat4 u_projection;
+#endif
 
 out vec4 v_color;
 
@@ -13,7 +29,13 @@ const vec3 light_color = vec3(1.0, 1.0, 1.0);
 
 void main()
 {
+#ifdef INSTANCED
+   mat4 model = in_model;
+#else
+   mat4 model = u_model;
+#endif
+
    // Outputs.
-   gl_Position = u_projection * u_view * u_model * vec4(in_pos, 1.0);
+   gl_Position = u_projection * u_view * model * vec4(in_pos, 1.0);
    v_color = vec4(light_color, 1.0);
 }
@@ -0,0 +1,10 @@
+#version 400 core
+
+// Bezier control point, in object space.
+layout (location = 0) in vec3 in_pos;
+
+void main()
+{
+    // Control points are only transformed once the patch has been evaluated.
+    gl_Position = vec4(in_pos, 1.0);
+}
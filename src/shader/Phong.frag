@@ -8,16 +8,38 @@ in vec2 tex_coords;
 
 out vec4 FragColor;
 
-// Phong material.
-uniform vec3 u_ka;
-uniform vec3 u_kd;
-uniform vec3 u_ks;
-uniform float u_shiny;
+// Phong materials of the scene, selected by index.
+#define MAX_MATERIALS 64
+// Shininess is packed in the 4th component of ks.
+struct Material
+{
+    vec4 ka;
+    vec4 kd;
+    vec4 ks_shiny;
+};
+layout (std140) uniform Materials
+{
+    Material u_materials[MAX_MATERIALS];
+};
+#ifdef INSTANCED
+// Per instance material index.
+flat in int material_index;
+#else
+uniform int u_material_index;
+#endif
 
-// Lighting.
-uniform float u_ambient_coef;
-uniform float u_diffuse_coef;
-uniform float u_specular_coef;
+// Per frame data, shared by all programs.
+layout (std140) uniform FrameData
+{
+    mat4 u_view;
+    mat4 u_projection;
+    mat4 u_light_view;
+    mat4 u_light_projection;
+    vec3 u_light_position;
+    float u_ambient_coef;
+    float u_diffuse_coef;
+    float u_specular_coef;
+};
 
 // Shadow map texture.
 uniform sampler2D shadow_map;
@@ -41,26 +63,36 @@ float computeShadow(vec4 frag_light_space_pos)
 
 void main()
 {
+#ifdef INSTANCED
+    Material material = u_materials[material_index];
+#else
+    Material material = u_materials[u_material_index];
+#endif
+    vec3 ka = material.ka.xyz;
+    vec3 kd = material.kd.xyz;
+    vec3 ks = material.ks_shiny.xyz;
+    float shiny = material.ks_shiny.w;
+
     vec3 normal = normalize(N);
     vec3 light  = normalize(L);
 
     vec4 tex_color = texture(object_texture, tex_coords);
 
     // Lighting components.
-    vec3 ambient = u_ambient_coef * u_ka * vec3(tex_color);
+    vec3 ambient = u_ambient_coef * ka * vec3(tex_color);
     vec3 diffuse = vec3(0.0);
     vec3 specular = vec3(0.0);
 
     float incidence = dot(light, normal);
     if (incidence >= 0.0) {
-        diffuse = u_diffuse_coef * incidence * u_kd * vec3(tex_color);
+        diffuse = u_diffuse_coef * incidence * kd * vec3(tex_color);
 
         // Reflected light vector.
         vec3 R = reflect(-light, normal);
         // Vector to viewer.
         vec3 V = -normalize(P);
         float specAngle = max(dot(R, V), 0.0);
-        specular = u_specular_coef * pow(specAngle, u_shiny) * u_ks;
+        specular = u_specular_coef * pow(specAngle, shiny) * ks;
     }
     float shadow = computeShadow(light_space_pos);
     vec3 final_color = (ambient + (1.0 - shadow) * (diffuse + specular)) * light_color;
@@ -13,25 +13,50 @@ out vec4 light_space_pos;
 // Texture coords.
 out vec2 tex_coords;
 
+// Per frame data, shared by all programs.
+layout (std140) uniform FrameData
+{
+    mat4 u_view;
+    mat4 u_projection;
+    mat4 u_light_view;
+    mat4 u_light_projection;
+    vec3 u_light_position;
+    float u_ambient_coef;
+    float u_diffuse_coef;
+    float u_specular_coef;
+};
+
+#ifdef INSTANCED
+// Per instance world transform and its normal matrix, read from the instance buffer.
+layout (location = 3) in mat4 in_model;
+layout (location = 7) in mat3 in_normal_matrix;
+layout (location = 10) in int in_material_index;
+flat out int material_index;
+#else
 // Transforms and geometry data.
 uniform mat4 u_model;
-uniform mat4 u_view;
-uniform mat4 u_projection;
-// Light source data and transforms.
-uniform mat4 u_light_view;
-uniform mat4 u_light_projection;
-uniform vec3 u_light_position;
+// Per object transforms precomputed on the CPU: u_view * u_model, and its normal matrix.
+uniform mat4 u_model_view;
+uniform mat3 u_normal_matrix;
+#endif
 
 void main()
 {
     // Transform vertex position and normal to view coordinates.
-    vec4 world_pos = u_model * vec4(in_pos, 1.0);
+#ifdef INSTANCED
+    vec4 world_pos = in_model * vec4(in_pos, 1.0);
     vec4 view_pos = u_view * world_pos;
     P = vec3(view_pos) / view_pos.w;
+    // Vertex normal. The view transformation is rigid, so its normal matrix is its 3x3 block.
+    N = normalize(mat3(u_view) * (in_normal_matrix * in_normal));
+    material_index = in_material_index;
+#else
+    vec4 world_pos = u_model * vec4(in_pos, 1.0);
+    vec4 view_pos = u_model_view * vec4(in_pos, 1.0);
+    P = vec3(view_pos) / view_pos.w;
     // Vertex normal.
-    N = normalize(
-       transpose(inverse(mat3(u_view * u_model))) * in_normal
-    );
+    N = normalize(u_normal_matrix * in_normal);
+#endif
 
     // Backwards light direction.
     vec4 light4 = u_view * vec4(u_light_position, 1.0);